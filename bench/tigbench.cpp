@@ -0,0 +1,510 @@
+// tigbench.cpp
+// Build: via CMake (`cmake --build build --target bench`), or
+//        g++ -std=gnu++17 -O2 -Wall -Wextra -o tigbench bench/tigbench.cpp
+// Purpose: Reproducible throughput/memory benchmark for text2png and txt2png.
+// Features:
+//  - Generates deterministic corpora (fixed-seed PRNG): short lyrics, long captions,
+//    CJK, emoji-heavy and an opt-in 1M-line file.
+//  - Runs every renderer configuration (text2png per backend/outline method,
+//    txt2png stroke vs offset) as a child process and measures wall time and
+//    peak RSS (wait4 rusage) of the child.
+//  - Reports lines/sec, ns per glyph, bytes per image and peak RSS as JSON so
+//    results can be compared across commits (see tigcompare.cpp). With
+//    --repeat N every metric is the median of N runs, with its MAD alongside.
+//
+// License: MIT
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <array>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if defined(_WIN32)
+#error "This tool targets Linux/Unix environments."
+#endif
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Corpora
+// ---------------------------------------------------------------------------
+
+// xorshift64* - tiny, fast and identical on every platform, so corpora are
+// byte-for-byte reproducible across machines and commits.
+struct Rng {
+    uint64_t s;
+    explicit Rng(uint64_t seed) : s(seed ? seed : 0x9E3779B97F4A7C15ull) {}
+    uint64_t next() {
+        s ^= s >> 12; s ^= s << 25; s ^= s >> 27;
+        return s * 0x2545F4914F6CDD1Dull;
+    }
+    size_t below(size_t n) { return static_cast<size_t>(next() % n); }
+};
+
+const std::vector<std::string> kWords = {
+    "ratkaisua", "testaus", "toimii", "sydän", "yö", "tähti", "laulu", "meri",
+    "love", "night", "fire", "heart", "dance", "forever", "shadow", "light",
+    "über", "straße", "café", "naïve", "señor", "déjà", "vu", "ämpäri",
+    "the", "and", "you", "we", "are", "in", "of", "to", "my", "your",
+};
+
+const std::vector<std::string> kCjk = {
+    "東", "京", "夜", "空", "星", "愛", "心", "歌", "光", "影", "雨", "風",
+    "花", "火", "海", "山", "夢", "時", "間", "世", "界", "日", "月", "人",
+    "の", "に", "は", "を", "が", "で", "と", "も", "か", "な", "さ", "し",
+    "ア", "イ", "ウ", "カ", "キ", "ク", "ラ", "リ", "ル", "シ", "ン", "ー",
+    "사", "랑", "해", "요", "우", "리", "노", "래", "하", "늘", "별", "빛",
+};
+
+const std::vector<std::string> kEmoji = {
+    "😀", "😂", "🥰", "😎", "🎵", "🎶", "🔥", "✨", "💖", "🌙", "⭐", "🎤",
+    "👍", "🙌", "💃", "🕺", "🌈", "🍀", "❤️", "👨‍👩‍👧", "🏳️‍🌈", "👋🏽",
+};
+
+struct Corpus {
+    std::string name;
+    size_t lines;
+    bool full_only;  // only generated/run with --full
+};
+
+const std::vector<Corpus> kCorpora = {
+    {"lyrics",   200,     false},
+    {"captions", 100,     false},
+    {"cjk",      200,     false},
+    {"emoji",    200,     false},
+    {"million",  1000000, true},
+};
+
+std::string join_words(Rng& rng, const std::vector<std::string>& pool, size_t count, const char* sep) {
+    std::string out;
+    for (size_t i = 0; i < count; ++i) {
+        if (i) out += sep;
+        out += pool[rng.below(pool.size())];
+    }
+    return out;
+}
+
+std::string make_line(const std::string& corpus, Rng& rng) {
+    if (corpus == "lyrics" || corpus == "million") {
+        return join_words(rng, kWords, 2 + rng.below(5), " ");
+    }
+    if (corpus == "captions") {
+        std::string s = join_words(rng, kWords, 20 + rng.below(15), " ");
+        s[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(s[0])));
+        return s + ".";
+    }
+    if (corpus == "cjk") {
+        return join_words(rng, kCjk, 6 + rng.below(14), "");
+    }
+    // emoji: words interleaved with one or two emoji
+    std::string s;
+    size_t n = 2 + rng.below(5);
+    for (size_t i = 0; i < n; ++i) {
+        if (i) s += " ";
+        s += kWords[rng.below(kWords.size())];
+        s += " ";
+        s += join_words(rng, kEmoji, 1 + rng.below(2), "");
+    }
+    return s;
+}
+
+// Writes <dir>/<name>.txt. The seed is derived from the corpus name only, so
+// a corpus never changes unless this generator changes.
+bool write_corpus(const std::string& dir, const Corpus& c, std::string& path) {
+    path = dir + "/" + c.name + ".txt";
+    uint64_t seed = 1469598103934665603ull;
+    for (char ch : c.name) seed = (seed ^ static_cast<unsigned char>(ch)) * 1099511628211ull;
+    Rng rng(seed);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    for (size_t i = 0; i < c.lines; ++i) out << make_line(c.name, rng) << '\n';
+    return static_cast<bool>(out);
+}
+
+// Non-empty lines and UTF-8 code points on them (the "glyph" denominator).
+void count_corpus(const std::string& path, size_t& lines, size_t& glyphs) {
+    lines = glyphs = 0;
+    std::ifstream in(path, std::ios::binary);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        ++lines;
+        for (unsigned char ch : line) {
+            if ((ch & 0xC0) != 0x80) ++glyphs;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Renderer configurations
+// ---------------------------------------------------------------------------
+
+struct Config {
+    std::string tool;     // "text2png" or "txt2png"
+    std::string backend;  // renderer backend inside the tool
+    std::string method;   // outline method
+    std::vector<std::string> args;  // extra style arguments
+};
+
+std::vector<Config> make_configs() {
+    return {
+        {"text2png", "cairo", "stroke", {"--font-size", "48", "--outline-width", "2"}},
+        {"text2png", "cairo", "fill",   {"--font-size", "48", "--outline-width", "0"}},
+        {"text2png", "cairo", "stroke-bg", {"--font-size", "48", "--outline-width", "2", "--bg-color", "#202020"}},
+        {"text2png", "cairo", "stroke-scales", {"--font-size", "48", "--outline-width", "2", "--scales", "1,1.5,2"}},
+        {"text2png", "cairo", "stroke-variants", {"--font-size", "48", "--outline-width", "2", "--variant", "base",
+                                                  "--variant", "yellow", "--text-color", "#FFFF00",
+                                                  "--variant", "wide", "--outline-width", "4"}},
+        {"txt2png",  "imagemagick", "stroke", {"--size", "48", "--outline", "2", "--outline-method", "stroke"}},
+        {"txt2png",  "imagemagick", "offset", {"--size", "48", "--outline", "2", "--outline-method", "offset"}},
+    };
+}
+
+std::vector<std::string> tool_argv(const std::string& exe, const Config& cfg,
+                                   const std::string& input, const std::string& prefix) {
+    std::vector<std::string> av{exe};
+    if (cfg.tool == "text2png") {
+        av.push_back(input);
+        av.push_back(prefix);
+    } else {
+        av.insert(av.end(), {"--input", input, "--prefix", prefix});
+    }
+    av.insert(av.end(), cfg.args.begin(), cfg.args.end());
+    return av;
+}
+
+// ---------------------------------------------------------------------------
+// Measurement
+// ---------------------------------------------------------------------------
+
+struct RunResult {
+    bool launched = false;
+    int exit_code = -1;
+    double wall_s = 0.0;
+    long peak_rss_kb = 0;
+};
+
+// fork/exec the renderer with stdout/stderr discarded and collect wall time
+// and the child's own peak RSS via wait4().
+RunResult run_child(const std::vector<std::string>& av) {
+    RunResult r;
+    std::vector<char*> cargv;
+    for (const auto& a : av) cargv.push_back(const_cast<char*>(a.c_str()));
+    cargv.push_back(nullptr);
+
+    auto t0 = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0) return r;
+    if (pid == 0) {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+            close(devnull);
+        }
+        execv(cargv[0], cargv.data());
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage ru{};
+    if (wait4(pid, &status, 0, &ru) < 0) return r;
+    auto t1 = std::chrono::steady_clock::now();
+
+    r.wall_s = std::chrono::duration<double>(t1 - t0).count();
+    r.peak_rss_kb = ru.ru_maxrss;
+    r.exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    r.launched = r.exit_code != 127;
+    return r;
+}
+
+// Sum and count *.png files in dir, then remove them so the next run starts clean.
+void collect_outputs(const std::string& dir, size_t& images, uint64_t& bytes) {
+    images = 0;
+    bytes = 0;
+    DIR* d = opendir(dir.c_str());
+    if (!d) return;
+    while (dirent* e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name.size() < 4 || name.compare(name.size() - 4, 4, ".png") != 0) continue;
+        std::string p = dir + "/" + name;
+        struct stat st{};
+        if (stat(p.c_str(), &st) == 0) {
+            ++images;
+            bytes += static_cast<uint64_t>(st.st_size);
+        }
+        unlink(p.c_str());
+    }
+    closedir(d);
+}
+
+bool make_dirs(const std::string& path) {
+    std::string cur;
+    std::istringstream iss(path);
+    std::string part;
+    if (!path.empty() && path[0] == '/') cur = "/";
+    while (std::getline(iss, part, '/')) {
+        if (part.empty()) continue;
+        cur += part + "/";
+        if (mkdir(cur.c_str(), 0755) != 0 && errno != EEXIST) return false;
+    }
+    return true;
+}
+
+std::string run_and_capture(const std::string& cmd) {
+    std::array<char, 256> buf{};
+    std::string out;
+    FILE* pipe = popen((cmd + " 2>/dev/null").c_str(), "r");
+    if (!pipe) return out;
+    size_t n;
+    while ((n = fread(buf.data(), 1, buf.size(), pipe)) > 0) out.append(buf.data(), n);
+    pclose(pipe);
+    while (!out.empty() && (out.back() == '\n' || out.back() == '\r')) out.pop_back();
+    return out;
+}
+
+std::string json_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            char tmp[8];
+            std::snprintf(tmp, sizeof(tmp), "\\u%04x", c);
+            out += tmp;
+        } else out += c;
+    }
+    return out;
+}
+
+// One measured run of a case.
+struct Sample {
+    size_t images = 0;
+    double wall_s = 0.0;
+    double lines_per_sec = 0.0;
+    double ns_per_glyph = 0.0;
+    double bytes_per_image = 0.0;
+    double peak_rss_kb = 0.0;
+};
+
+double median(std::vector<double> v) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+// Median absolute deviation: robust spread estimate that ignores the odd
+// outlier run (page cache miss, noisy neighbour) instead of averaging it in.
+double mad(std::vector<double> v) {
+    double m = median(v);
+    for (double& x : v) x = std::fabs(x - m);
+    return median(v);
+}
+
+// Writes ', "<key>": {...}' with stat() applied to every metric across runs.
+void write_stats(std::ostringstream& json, const char* key, const std::vector<Sample>& samples,
+                 double (*stat)(std::vector<double>)) {
+    auto col = [&](double Sample::*field) {
+        std::vector<double> v;
+        for (const Sample& s : samples) v.push_back(s.*field);
+        return stat(v);
+    };
+    char buf[512];
+    std::snprintf(buf, sizeof(buf),
+                  ", \"%s\": {\"wall_s\": %.6f, \"lines_per_sec\": %.3f, \"ns_per_glyph\": %.1f, "
+                  "\"bytes_per_image\": %.1f, \"peak_rss_kb\": %.0f}",
+                  key, col(&Sample::wall_s), col(&Sample::lines_per_sec), col(&Sample::ns_per_glyph),
+                  col(&Sample::bytes_per_image), col(&Sample::peak_rss_kb));
+    json << buf;
+}
+
+struct Options {
+    std::string text2png;
+    std::string txt2png;
+    std::string work_dir = "bench-work";
+    std::string out_path = "bench-results.json";
+    std::string source_dir = ".";
+    std::string only;          // substring filter on result names
+    size_t max_lines = 0;      // 0 = whole corpus
+    int repeat = 1;            // measured runs per case (median/MAD over these)
+    int warmup = 0;            // discarded runs per case
+    std::string simd;          // text2png --simd level, empty = tool default
+    bool full = false;
+};
+
+void print_help(const char* argv0) {
+    std::cout << "Usage:\n"
+              << "  " << argv0 << " [options]\n\n"
+              << "Options:\n"
+              << "  --text2png PATH         text2png executable (skipped if missing)\n"
+              << "  --txt2png PATH          txt2png executable (skipped if missing)\n"
+              << "  --work-dir DIR          Corpora and scratch output directory (default: bench-work)\n"
+              << "  --out FILE              JSON results file (default: bench-results.json)\n"
+              << "  --source-dir DIR        Source tree, used to record the git commit (default: .)\n"
+              << "  --only STR              Run only cases whose name contains STR\n"
+              << "  --max-lines N           Truncate every corpus to N lines\n"
+              << "  --repeat N              Measured runs per case; metrics are medians (default: 1)\n"
+              << "  --warmup N              Discarded warm-up runs per case (default: 0)\n"
+              << "  --simd LEVEL            Pass --simd LEVEL to text2png (auto|scalar|sse4|avx2|avx512)\n"
+              << "  --full                  Also run the 1M-line corpus\n"
+              << "  --help                  Show this help\n\n"
+              << "Case names are '<tool>/<backend>/<method>/<corpus>'.\n";
+}
+
+bool parse_args(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto need_val = [&](const char* flag) {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << flag << "\n";
+                return false;
+            }
+            return true;
+        };
+
+        if (a == "--help" || a == "-h") { print_help(argv[0]); std::exit(0); }
+        else if (a == "--text2png") { if (!need_val("--text2png")) return false; opt.text2png = argv[++i]; }
+        else if (a == "--txt2png") { if (!need_val("--txt2png")) return false; opt.txt2png = argv[++i]; }
+        else if (a == "--work-dir") { if (!need_val("--work-dir")) return false; opt.work_dir = argv[++i]; }
+        else if (a == "--out") { if (!need_val("--out")) return false; opt.out_path = argv[++i]; }
+        else if (a == "--source-dir") { if (!need_val("--source-dir")) return false; opt.source_dir = argv[++i]; }
+        else if (a == "--only") { if (!need_val("--only")) return false; opt.only = argv[++i]; }
+        else if (a == "--max-lines") { if (!need_val("--max-lines")) return false; opt.max_lines = std::stoul(argv[++i]); }
+        else if (a == "--repeat") { if (!need_val("--repeat")) return false; opt.repeat = std::max(1, std::stoi(argv[++i])); }
+        else if (a == "--warmup") { if (!need_val("--warmup")) return false; opt.warmup = std::max(0, std::stoi(argv[++i])); }
+        else if (a == "--simd") { if (!need_val("--simd")) return false; opt.simd = argv[++i]; }
+        else if (a == "--full") { opt.full = true; }
+        else {
+            std::cerr << "Unknown option: " << a << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        std::cerr << "Use --help for usage.\n";
+        return 2;
+    }
+
+    const std::string corpus_dir = opt.work_dir + "/corpus";
+    const std::string scratch_dir = opt.work_dir + "/out";
+    if (!make_dirs(corpus_dir) || !make_dirs(scratch_dir)) {
+        std::cerr << "Error: cannot create work directory: " << opt.work_dir << "\n";
+        return 3;
+    }
+
+    char host[256] = "";
+    gethostname(host, sizeof(host) - 1);
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"schema\": 2,\n"
+         << "  \"commit\": \"" << json_escape(run_and_capture("git -C \"" + opt.source_dir + "\" rev-parse --short HEAD")) << "\",\n"
+         << "  \"host\": \"" << json_escape(host) << "\",\n"
+         << "  \"simd\": \"" << json_escape(opt.simd.empty() ? "auto" : opt.simd) << "\",\n"
+         << "  \"results\": [";
+
+    bool first = true;
+    int failures = 0;
+    for (const Corpus& corpus : kCorpora) {
+        if (corpus.full_only && !opt.full) continue;
+
+        Corpus c = corpus;
+        if (opt.max_lines > 0 && c.lines > opt.max_lines) c.lines = opt.max_lines;
+        std::string input;
+        if (!write_corpus(corpus_dir, c, input)) {
+            std::cerr << "Error: cannot write corpus: " << input << "\n";
+            return 4;
+        }
+        size_t lines = 0, glyphs = 0;
+        count_corpus(input, lines, glyphs);
+
+        for (const Config& cfg : make_configs()) {
+            const std::string name = cfg.tool + "/" + cfg.backend + "/" + cfg.method + "/" + c.name;
+            if (!opt.only.empty() && name.find(opt.only) == std::string::npos) continue;
+
+            const std::string& exe = cfg.tool == "text2png" ? opt.text2png : opt.txt2png;
+            std::string status = "ok";
+            int exit_code = 0;
+            std::vector<Sample> samples;
+            if (exe.empty() || access(exe.c_str(), X_OK) != 0) {
+                status = "skipped";
+            } else {
+                std::cerr << "bench: " << name << " (" << lines << " lines, "
+                          << opt.warmup << "+" << opt.repeat << " runs)\n";
+                auto av = tool_argv(exe, cfg, input, scratch_dir + "/img-");
+                if (cfg.tool == "text2png" && !opt.simd.empty()) av.insert(av.end(), {"--simd", opt.simd});
+                for (int run = 0; run < opt.warmup + opt.repeat; ++run) {
+                    RunResult r = run_child(av);
+                    size_t images = 0;
+                    uint64_t bytes = 0;
+                    collect_outputs(scratch_dir, images, bytes);
+                    if (!r.launched || r.exit_code != 0) {
+                        status = "failed";
+                        exit_code = r.exit_code;
+                        ++failures;
+                        std::cerr << "bench: " << name << " failed (exit " << r.exit_code << ")\n";
+                        break;
+                    }
+                    if (run < opt.warmup) continue;
+                    Sample smp;
+                    smp.images = images;
+                    smp.wall_s = r.wall_s;
+                    smp.lines_per_sec = r.wall_s > 0 ? lines / r.wall_s : 0.0;
+                    smp.ns_per_glyph = glyphs > 0 ? r.wall_s * 1e9 / glyphs : 0.0;
+                    smp.bytes_per_image = images > 0 ? static_cast<double>(bytes) / images : 0.0;
+                    smp.peak_rss_kb = static_cast<double>(r.peak_rss_kb);
+                    samples.push_back(smp);
+                }
+            }
+
+            json << (first ? "\n" : ",\n");
+            first = false;
+            json << "    {\"name\": \"" << json_escape(name) << "\", \"tool\": \"" << cfg.tool
+                 << "\", \"backend\": \"" << cfg.backend << "\", \"method\": \"" << cfg.method
+                 << "\", \"corpus\": \"" << c.name << "\", \"status\": \"" << status << "\"";
+            if (status == "ok") {
+                json << ", \"runs\": " << samples.size()
+                     << ", \"lines\": " << lines << ", \"glyphs\": " << glyphs
+                     << ", \"images\": " << samples.front().images;
+                write_stats(json, "metrics", samples, median);
+                write_stats(json, "mad", samples, mad);
+            } else if (status == "failed") {
+                json << ", \"exit_code\": " << exit_code;
+            }
+            json << "}";
+        }
+    }
+    json << "\n  ]\n}\n";
+
+    std::ofstream out(opt.out_path, std::ios::trunc);
+    if (!out || !(out << json.str())) {
+        std::cerr << "Error: cannot write results: " << opt.out_path << "\n";
+        return 5;
+    }
+    std::cerr << "Wrote " << opt.out_path << "\n";
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,411 @@
+// tigcompare.cpp
+// Build: via CMake (`cmake --build build --target bench-check`), or
+//        g++ -std=gnu++17 -O2 -Wall -Wextra -o tigcompare bench/tigcompare.cpp
+// Purpose: Performance regression gate. Compares a tigbench results file against
+//          the checked-in baseline (bench/baseline.json) and fails on regressions.
+// Features:
+//  - Per-metric noise thresholds stored in the baseline ("thresholds" object):
+//    direction ("higher"/"lower" is better), relative tolerance and a MAD
+//    multiplier. A metric regresses when it moves in the bad direction by more
+//    than max(rel * baseline, mad_k * max(baseline MAD, current MAD)).
+//  - Prints a pass/fail table and exits non-zero on any regression, and also
+//    when the baseline holds no results or no metric could be compared.
+//  - --update rewrites the baseline with the current results, keeping thresholds.
+//  - No network or external tools; plain files only.
+//
+// License: MIT
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#if defined(_WIN32)
+#error "This tool targets Linux/Unix environments."
+#endif
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Minimal JSON value + parser (enough for tigbench output; no \u surrogates)
+// ---------------------------------------------------------------------------
+
+struct Json {
+    enum Type { Null, Bool, Number, String, Array, Object } type = Null;
+    bool b = false;
+    double num = 0.0;
+    std::string str;
+    std::vector<Json> arr;
+    std::vector<std::pair<std::string, Json>> obj;  // keeps key order for --update
+
+    const Json* get(const std::string& key) const {
+        for (const auto& kv : obj) if (kv.first == key) return &kv.second;
+        return nullptr;
+    }
+    double number(const std::string& key, double def = 0.0) const {
+        const Json* v = get(key);
+        return (v && v->type == Number) ? v->num : def;
+    }
+    std::string string(const std::string& key, const std::string& def = "") const {
+        const Json* v = get(key);
+        return (v && v->type == String) ? v->str : def;
+    }
+};
+
+class Parser {
+public:
+    explicit Parser(const std::string& text) : s_(text) {}
+
+    bool parse(Json& out, std::string& err) {
+        if (!value(out) || (ws(), pos_ != s_.size())) {
+            err = "JSON parse error at offset " + std::to_string(pos_);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    const std::string& s_;
+    size_t pos_ = 0;
+
+    void ws() { while (pos_ < s_.size() && std::isspace(static_cast<unsigned char>(s_[pos_]))) ++pos_; }
+    bool eat(char c) { ws(); if (pos_ < s_.size() && s_[pos_] == c) { ++pos_; return true; } return false; }
+    bool literal(const char* lit) {
+        size_t n = std::strlen(lit);
+        if (s_.compare(pos_, n, lit) != 0) return false;
+        pos_ += n;
+        return true;
+    }
+
+    bool string(std::string& out) {
+        if (!eat('"')) return false;
+        while (pos_ < s_.size() && s_[pos_] != '"') {
+            char c = s_[pos_++];
+            if (c == '\\' && pos_ < s_.size()) {
+                char e = s_[pos_++];
+                switch (e) {
+                    case 'n': out += '\n'; break;
+                    case 't': out += '\t'; break;
+                    case 'r': out += '\r'; break;
+                    case 'u':
+                        if (pos_ + 4 > s_.size()) return false;
+                        out += static_cast<char>(std::strtol(s_.substr(pos_, 4).c_str(), nullptr, 16));
+                        pos_ += 4;
+                        break;
+                    default: out += e;
+                }
+            } else {
+                out += c;
+            }
+        }
+        return eat('"');
+    }
+
+    bool value(Json& v) {
+        ws();
+        if (pos_ >= s_.size()) return false;
+        char c = s_[pos_];
+        if (c == '{') {
+            ++pos_;
+            v.type = Json::Object;
+            if (eat('}')) return true;
+            do {
+                std::string key;
+                Json child;
+                if (!string(key) || !eat(':') || !value(child)) return false;
+                v.obj.emplace_back(std::move(key), std::move(child));
+            } while (eat(','));
+            return eat('}');
+        }
+        if (c == '[') {
+            ++pos_;
+            v.type = Json::Array;
+            if (eat(']')) return true;
+            do {
+                Json child;
+                if (!value(child)) return false;
+                v.arr.push_back(std::move(child));
+            } while (eat(','));
+            return eat(']');
+        }
+        if (c == '"') { v.type = Json::String; return string(v.str); }
+        if (literal("true")) { v.type = Json::Bool; v.b = true; return true; }
+        if (literal("false")) { v.type = Json::Bool; return true; }
+        if (literal("null")) { v.type = Json::Null; return true; }
+        char* end = nullptr;
+        v.num = std::strtod(s_.c_str() + pos_, &end);
+        if (end == s_.c_str() + pos_) return false;
+        v.type = Json::Number;
+        pos_ = static_cast<size_t>(end - s_.c_str());
+        return true;
+    }
+};
+
+void dump(const Json& v, std::ostream& out, int depth) {
+    // Pretty-print the top two levels, keep leaf records on one line so the
+    // checked-in baseline diffs one case per line.
+    const bool pretty = depth < 2;
+    const std::string pad(static_cast<size_t>(2 * (depth + 1)), ' ');
+    const std::string close_pad(static_cast<size_t>(2 * depth), ' ');
+    switch (v.type) {
+        case Json::Null: out << "null"; break;
+        case Json::Bool: out << (v.b ? "true" : "false"); break;
+        case Json::Number: {
+            char buf[64];
+            std::snprintf(buf, sizeof(buf), "%.10g", v.num);
+            out << buf;
+            break;
+        }
+        case Json::String: {
+            out << '"';
+            for (char c : v.str) {
+                if (c == '"' || c == '\\') out << '\\' << c;
+                else if (c == '\n') out << "\\n";
+                else out << c;
+            }
+            out << '"';
+            break;
+        }
+        case Json::Array:
+            out << '[';
+            for (size_t i = 0; i < v.arr.size(); ++i) {
+                out << (i ? "," : "") << (pretty ? "\n" + pad : (i ? " " : ""));
+                dump(v.arr[i], out, depth + 1);
+            }
+            if (pretty && !v.arr.empty()) out << "\n" << close_pad;
+            out << ']';
+            break;
+        case Json::Object:
+            out << '{';
+            for (size_t i = 0; i < v.obj.size(); ++i) {
+                out << (i ? "," : "") << (pretty ? "\n" + pad : (i ? " " : ""));
+                Json key;
+                key.type = Json::String;
+                key.str = v.obj[i].first;
+                dump(key, out, depth + 1);
+                out << ": ";
+                dump(v.obj[i].second, out, depth + 1);
+            }
+            if (pretty && !v.obj.empty()) out << "\n" << close_pad;
+            out << '}';
+            break;
+    }
+}
+
+bool load_json(const std::string& path, Json& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Error: cannot open " << path << "\n";
+        return false;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string text = ss.str();
+    std::string err;
+    if (!Parser(text).parse(out, err) || out.type != Json::Object) {
+        std::cerr << "Error: " << path << ": " << (err.empty() ? "expected a JSON object" : err) << "\n";
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Comparison
+// ---------------------------------------------------------------------------
+
+struct Threshold {
+    bool higher_is_better = false;
+    double rel = 0.10;    // relative tolerance
+    double mad_k = 3.0;   // noise multiplier on the larger MAD
+};
+
+std::map<std::string, Threshold> read_thresholds(const Json& baseline) {
+    std::map<std::string, Threshold> out;
+    const Json* t = baseline.get("thresholds");
+    if (!t || t->type != Json::Object) return out;
+    for (const auto& kv : t->obj) {
+        Threshold th;
+        th.higher_is_better = kv.second.string("better", "lower") == "higher";
+        th.rel = kv.second.number("rel", th.rel);
+        th.mad_k = kv.second.number("mad_k", th.mad_k);
+        out[kv.first] = th;
+    }
+    return out;
+}
+
+std::map<std::string, const Json*> index_results(const Json& doc) {
+    std::map<std::string, const Json*> out;
+    const Json* r = doc.get("results");
+    if (!r || r->type != Json::Array) return out;
+    for (const Json& e : r->arr) out[e.string("name")] = &e;
+    return out;
+}
+
+struct Options {
+    std::string baseline_path;
+    std::string current_path;
+    bool update = false;
+    bool strict = false;  // treat missing/skipped cases as failures
+};
+
+void print_help(const char* argv0) {
+    std::cout << "Usage:\n"
+              << "  " << argv0 << " [options] BASELINE.json CURRENT.json\n\n"
+              << "Options:\n"
+              << "  --update                Rewrite BASELINE with CURRENT's results (thresholds kept)\n"
+              << "  --strict                Fail on cases missing or skipped in CURRENT\n"
+              << "  --help                  Show this help\n\n"
+              << "Exit status: 0 = no regressions, 1 = regression, 2 = usage/input error.\n";
+}
+
+bool parse_args(int argc, char** argv, Options& opt) {
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--help" || a == "-h") { print_help(argv[0]); std::exit(0); }
+        else if (a == "--update") { opt.update = true; }
+        else if (a == "--strict") { opt.strict = true; }
+        else if (!a.empty() && a[0] == '-') {
+            std::cerr << "Unknown option: " << a << "\n";
+            return false;
+        } else {
+            positional.push_back(a);
+        }
+    }
+    if (positional.size() != 2) {
+        std::cerr << "Error: expected BASELINE.json and CURRENT.json\n";
+        return false;
+    }
+    opt.baseline_path = positional[0];
+    opt.current_path = positional[1];
+    return true;
+}
+
+int update_baseline(const Options& opt, Json baseline, const Json& current) {
+    // The results and where they were recorded (commit, host) come from current
+    for (const char* key : {"commit", "host", "results"}) {
+        const Json* v = current.get(key);
+        if (!v) continue;
+        bool replaced = false;
+        for (auto& kv : baseline.obj) {
+            if (kv.first == key) {
+                kv.second = *v;
+                replaced = true;
+            }
+        }
+        if (!replaced) baseline.obj.emplace_back(key, *v);
+    }
+    std::ofstream out(opt.baseline_path, std::ios::trunc);
+    dump(baseline, out, 0);
+    out << "\n";
+    if (!out) {
+        std::cerr << "Error: cannot write " << opt.baseline_path << "\n";
+        return 2;
+    }
+    std::cout << "Updated baseline: " << opt.baseline_path << "\n";
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        std::cerr << "Use --help for usage.\n";
+        return 2;
+    }
+
+    Json baseline, current;
+    if (!load_json(opt.baseline_path, baseline) || !load_json(opt.current_path, current)) return 2;
+    if (opt.update) return update_baseline(opt, baseline, current);
+
+    const auto thresholds = read_thresholds(baseline);
+    const auto base = index_results(baseline);
+    const auto cur = index_results(current);
+    if (base.empty()) {
+        std::fprintf(stderr, "Error: baseline %s has no results; record one with the bench-baseline target\n",
+                     opt.baseline_path.c_str());
+        return 1;
+    }
+
+    std::printf("baseline %s (%s) vs current %s (%s)\n\n", baseline.string("commit", "?").c_str(),
+                baseline.string("host", "?").c_str(), current.string("commit", "?").c_str(),
+                current.string("host", "?").c_str());
+    std::printf("%-44s %-16s %14s %14s %9s %9s  %s\n",
+                "case", "metric", "baseline", "current", "delta", "limit", "result");
+
+    int failed = 0, passed = 0, notes = 0;
+    auto row = [](const std::string& name, const char* metric, const char* b, const char* c,
+                  const char* d, const char* l, const char* res) {
+        std::printf("%-44s %-16s %14s %14s %9s %9s  %s\n", name.c_str(), metric, b, c, d, l, res);
+    };
+
+    for (const auto& kv : cur) {
+        const std::string& name = kv.first;
+        const Json& c = *kv.second;
+        auto it = base.find(name);
+        const std::string cstatus = c.string("status");
+        if (cstatus == "failed") {
+            row(name, "-", "-", "-", "-", "-", "FAIL (run failed)");
+            ++failed;
+            continue;
+        }
+        if (it == base.end() || it->second->string("status") != "ok") {
+            row(name, "-", "-", "-", "-", "-", cstatus == "ok" ? "NEW" : "SKIP");
+            ++notes;
+            continue;
+        }
+        if (cstatus != "ok") {
+            row(name, "-", "-", "-", "-", "-", opt.strict ? "FAIL (skipped)" : "SKIP");
+            opt.strict ? ++failed : ++notes;
+            continue;
+        }
+
+        const Json* bm = it->second->get("metrics");
+        const Json* bmad = it->second->get("mad");
+        const Json* cm = c.get("metrics");
+        const Json* cmad = c.get("mad");
+        if (!bm || !cm) continue;
+        for (const auto& t : thresholds) {
+            const std::string& metric = t.first;
+            const Threshold& th = t.second;
+            const Json* bv = bm->get(metric);
+            const Json* cv = cm->get(metric);
+            if (!bv || !cv) continue;
+            double b = bv->num, v = cv->num;
+            double noise = std::max(bmad ? bmad->number(metric) : 0.0, cmad ? cmad->number(metric) : 0.0);
+            double allowed = std::max(th.rel * std::fabs(b), th.mad_k * noise);
+            double worse = th.higher_is_better ? b - v : v - b;
+            bool ok = worse <= allowed;
+
+            char sb[32], sc[32], sd[32], sl[32];
+            std::snprintf(sb, sizeof(sb), "%.6g", b);
+            std::snprintf(sc, sizeof(sc), "%.6g", v);
+            std::snprintf(sd, sizeof(sd), "%+.1f%%", b != 0.0 ? 100.0 * (v - b) / std::fabs(b) : 0.0);
+            std::snprintf(sl, sizeof(sl), "%.1f%%", b != 0.0 ? 100.0 * allowed / std::fabs(b) : 0.0);
+            row(name, metric.c_str(), sb, sc, sd, sl, ok ? "pass" : "FAIL");
+            ok ? ++passed : ++failed;
+        }
+    }
+    for (const auto& kv : base) {
+        if (cur.count(kv.first) || kv.second->string("status") != "ok") continue;
+        row(kv.first, "-", "-", "-", "-", "-", opt.strict ? "FAIL (missing)" : "MISSING");
+        opt.strict ? ++failed : ++notes;
+    }
+
+    std::printf("\n%d passed, %d failed, %d not compared\n", passed, failed, notes);
+    if (passed == 0 && failed == 0) {
+        std::printf("RESULT: FAIL (no case could be compared against the baseline)\n");
+        return 1;
+    }
+    std::printf("%s\n", failed ? "RESULT: FAIL" : "RESULT: PASS");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,215 @@
+// tigstartup.cpp
+// Build: via CMake (`cmake --build build --target bench-startup`), or
+//        g++ -std=gnu++17 -O2 -Wall -Wextra -o tigstartup bench/tigstartup.cpp
+// Purpose: Cold-start benchmark for short text2png invocations, e.g. the
+//          dynamic build against bin/text2png-static (build_static_text2png.sh).
+// Features:
+//  - "exec" mode runs the binary without arguments (usage and exit): process
+//    creation, dynamic loading/relocation and static constructors only.
+//  - "line" mode renders a single line, the typical per-clip script call,
+//    which adds font lookup and one render/encode/write.
+//  - Reports min / median / p90 wall time and median peak RSS per binary and
+//    mode, as a table and optionally as JSON. Missing binaries are listed and
+//    skipped; the exit status is 1 only if nothing could be measured.
+//
+// License: MIT
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if defined(_WIN32)
+#error "This tool targets Linux/Unix environments."
+#endif
+
+namespace {
+
+struct RunResult {
+    bool launched = false;
+    double wall_s = 0.0;
+    long peak_rss_kb = 0;
+};
+
+// fork/exec with stdout/stderr discarded; the exit code is ignored because
+// "exec" mode deliberately ends in the usage error path.
+RunResult run_child(const std::vector<std::string>& av) {
+    RunResult r;
+    std::vector<char*> cargv;
+    for (const auto& a : av) cargv.push_back(const_cast<char*>(a.c_str()));
+    cargv.push_back(nullptr);
+
+    auto t0 = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0) return r;
+    if (pid == 0) {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+            close(devnull);
+        }
+        execv(cargv[0], cargv.data());
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage ru{};
+    if (wait4(pid, &status, 0, &ru) < 0) return r;
+    auto t1 = std::chrono::steady_clock::now();
+
+    r.wall_s = std::chrono::duration<double>(t1 - t0).count();
+    r.peak_rss_kb = ru.ru_maxrss;
+    r.launched = !(WIFEXITED(status) && WEXITSTATUS(status) == 127);
+    return r;
+}
+
+double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t idx = static_cast<size_t>(p * (v.size() - 1) + 0.5);
+    return v[std::min(idx, v.size() - 1)];
+}
+
+struct Options {
+    std::vector<std::string> exes;
+    std::string work_dir = "startup-work";
+    std::string json_path;     // empty = table only
+    int runs = 50;
+    int warmup = 3;
+};
+
+void print_help(const char* argv0) {
+    std::cout << "Usage:\n"
+              << "  " << argv0 << " [options] EXE [EXE...]\n\n"
+              << "Options:\n"
+              << "  --runs N                Measured runs per binary and mode (default: 50)\n"
+              << "  --warmup N              Discarded runs first, to warm the page cache (default: 3)\n"
+              << "  --work-dir DIR          Input file and scratch output (default: startup-work)\n"
+              << "  --json FILE             Also write results as JSON\n"
+              << "  --help                  Show this help\n";
+}
+
+bool parse_args(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto need_val = [&](const char* flag) {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << flag << "\n";
+                return false;
+            }
+            return true;
+        };
+
+        if (a == "--help" || a == "-h") { print_help(argv[0]); std::exit(0); }
+        else if (a == "--runs") { if (!need_val("--runs")) return false; opt.runs = std::max(1, std::stoi(argv[++i])); }
+        else if (a == "--warmup") { if (!need_val("--warmup")) return false; opt.warmup = std::max(0, std::stoi(argv[++i])); }
+        else if (a == "--work-dir") { if (!need_val("--work-dir")) return false; opt.work_dir = argv[++i]; }
+        else if (a == "--json") { if (!need_val("--json")) return false; opt.json_path = argv[++i]; }
+        else if (!a.empty() && a[0] == '-') {
+            std::cerr << "Unknown option: " << a << "\n";
+            return false;
+        } else {
+            opt.exes.push_back(a);
+        }
+    }
+    if (opt.exes.empty()) {
+        std::cerr << "Error: at least one executable required\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        std::cerr << "Use --help for usage.\n";
+        return 2;
+    }
+    if (mkdir(opt.work_dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Error: cannot create work directory: " << opt.work_dir << "\n";
+        return 3;
+    }
+    const std::string input = opt.work_dir + "/line.txt";
+    const std::string prefix = opt.work_dir + "/line-";
+    {
+        std::ofstream f(input, std::ios::trunc);
+        f << "Startup benchmark line\n";
+    }
+
+    std::ostringstream json;
+    json << "{\n  \"runs\": " << opt.runs << ",\n  \"results\": [";
+    bool first = true;
+
+    std::printf("%-40s %-5s %10s %10s %10s %10s\n", "binary", "mode", "min ms", "median ms", "p90 ms", "rss KiB");
+    for (const std::string& exe : opt.exes) {
+        if (access(exe.c_str(), X_OK) != 0) {
+            std::printf("%-40s (not found)\n", exe.c_str());
+            continue;
+        }
+        for (const char* mode : {"exec", "line"}) {
+            std::vector<std::string> av{exe};
+            if (std::strcmp(mode, "line") == 0) av.insert(av.end(), {input, prefix, "-q"});
+
+            std::vector<double> wall, rss;
+            bool ok = true;
+            for (int run = 0; run < opt.warmup + opt.runs; ++run) {
+                RunResult r = run_child(av);
+                if (!r.launched) {
+                    ok = false;
+                    break;
+                }
+                if (run < opt.warmup) continue;
+                wall.push_back(r.wall_s * 1e3);
+                rss.push_back(static_cast<double>(r.peak_rss_kb));
+            }
+            unlink((prefix + "1.png").c_str());
+            if (!ok) {
+                std::printf("%-40s %-5s (failed to launch)\n", exe.c_str(), mode);
+                continue;
+            }
+
+            const double mn = percentile(wall, 0.0), med = percentile(wall, 0.5), p90 = percentile(wall, 0.9);
+            const double rss_med = percentile(rss, 0.5);
+            std::printf("%-40s %-5s %10.3f %10.3f %10.3f %10.0f\n", exe.c_str(), mode, mn, med, p90, rss_med);
+
+            char buf[256];
+            std::snprintf(buf, sizeof(buf),
+                          "\"mode\": \"%s\", \"min_ms\": %.4f, \"median_ms\": %.4f, \"p90_ms\": %.4f, \"peak_rss_kb\": %.0f}",
+                          mode, mn, med, p90, rss_med);
+            std::string name;
+            for (char c : exe) {
+                if (c == '"' || c == '\\') name += '\\';
+                name += c;
+            }
+            json << (first ? "\n" : ",\n") << "    {\"binary\": \"" << name << "\", " << buf;
+            first = false;
+        }
+    }
+    json << "\n  ]\n}\n";
+
+    if (!opt.json_path.empty()) {
+        std::ofstream out(opt.json_path, std::ios::trunc);
+        if (!out) {
+            std::cerr << "Error: cannot write " << opt.json_path << "\n";
+            return 3;
+        }
+        out << json.str();
+    }
+    return first ? 1 : 0;  // nothing measured
+}
@@ -10,14 +10,21 @@ mkdir -p bin
 
 echo "Building text2png (Cairo-based)..."
 
+# TIG_INSTRUMENT=1 ./build.sh builds the allocation-accounting variant (see --stats)
+EXTRA_FLAGS=""
+if [ "${TIG_INSTRUMENT:-0}" = "1" ]; then
+    echo "Instrumentation build: counting allocations per render stage"
+    EXTRA_FLAGS="$EXTRA_FLAGS -DTIG_INSTRUMENT"
+fi
+
 # Build the Cairo-based executable if libraries are available
-if pkg-config --exists cairo && pkg-config --exists fontconfig && pkg-config --exists freetype2; then
+if pkg-config --exists cairo && pkg-config --exists fontconfig && pkg-config --exists freetype2 && pkg-config --exists libpng; then
     echo "Building Cairo-based renderer..."
-    g++ -std=gnu++17 -O2 -Wall -Wextra -o bin/text2png text2png.cpp -I/usr/include/cairo -I/usr/include/libpng16 -I/usr/include/pixman-1 -I/usr/include/freetype2 -lcairo -lfontconfig -lfreetype
+    g++ -std=gnu++17 -O2 -Wall -Wextra -pthread $EXTRA_FLAGS -o bin/text2png text2png.cpp $(pkg-config --cflags --libs cairo fontconfig freetype2 libpng)
     echo "Cairo-based text2png built successfully!"
 else
     echo "Error: Cairo dependencies not found."
-    echo "To build, install: cairo, fontconfig, and freetype2 development packages"
+    echo "To build, install: cairo, fontconfig, freetype2, and libpng development packages"
     exit 1
 fi
 
@@ -4,20 +4,20 @@
 # This script compiles the Cairo-based text to PNG converter
 
 # Check if all required libraries are available
-if ! pkg-config --exists cairo || ! pkg-config --exists fontconfig || ! pkg-config --exists freetype2; then
+if ! pkg-config --exists cairo || ! pkg-config --exists fontconfig || ! pkg-config --exists freetype2 || ! pkg-config --exists libpng; then
     echo "Error: Required libraries (cairo, fontconfig, freetype2) not found"
     exit 1
 fi
 
 # Get the compilation flags
-CFLAGS=$(pkg-config --cflags cairo fontconfig freetype2)
-LIBS=$(pkg-config --libs cairo fontconfig freetype2)
+CFLAGS=$(pkg-config --cflags cairo fontconfig freetype2 libpng)
+LIBS=$(pkg-config --libs cairo fontconfig freetype2 libpng)
 
 echo "Compiling with flags: $CFLAGS"
 echo "Linking with libs: $LIBS"
 
 # Compile the program
-g++ -o bin/text2png text2png.cpp $CFLAGS $LIBS
+g++ -std=gnu++17 -O2 -Wall -Wextra -pthread -o bin/text2png text2png.cpp $CFLAGS $LIBS
 
 if [ $? -eq 0 ]; then
     echo "Compilation successful!"
@@ -2,6 +2,8 @@
 
 # TextImageGen - Static Build Script
 # Builds a statically linked version of the executable
+# (for a static text2png with cairo and its dependencies bundled, see
+# build_static_text2png.sh)
 
 set -e  # Exit on any error
 
@@ -11,7 +13,7 @@ mkdir -p bin
 echo "Building static txt2png..."
 
 # Build the executable with static linking
-g++ -std=gnu++17 -O2 -Wall -Wextra -static -o bin/txt2png-static txt2png.cpp
+g++ -std=gnu++17 -O2 -Wall -Wextra -pthread -static -o bin/txt2png-static txt2png.cpp
 
 echo "Static build completed successfully!"
 echo "Static executable is located at: bin/txt2png-static"
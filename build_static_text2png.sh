@@ -0,0 +1,160 @@
+#!/bin/bash
+
+# TextImageGen - Static text2png Build Script
+# Builds bin/text2png-static with zlib, libpng, freetype, expat, fontconfig,
+# pixman and cairo compiled from pinned source releases into a private prefix,
+# so the binary starts without the dynamic loader or symbol relocation.
+#
+# Usage: ./build_static_text2png.sh [WORK_DIR]   (default: build-static)
+#
+# Reproducibility:
+#  - Versions are pinned below; tarball SHA-256 sums are kept in
+#    static-deps.sha256. A tarball without an entry or with a different sum
+#    aborts the build. After a version bump, check the new tarballs against
+#    the upstream signatures and record their sums with
+#    UPDATE_LOCK=1 ./build_static_text2png.sh, then commit the file.
+#  - SOURCE_DATE_EPOCH comes from the last commit, archives are written in
+#    deterministic mode and build paths are mapped away, so two builds of the
+#    same commit on the same toolchain produce the same binary (the final
+#    SHA-256 is printed for comparison).
+#
+# Requires: gcc/g++, make, meson, ninja, curl, pkg-config, python3.
+
+set -e  # Exit on any error
+
+ROOT=$(cd "$(dirname "$0")" && pwd)
+WORK=${1:-"$ROOT/build-static"}
+case "$WORK" in /*) ;; *) WORK="$ROOT/$WORK" ;; esac
+SRC="$WORK/src"
+PREFIX="$WORK/prefix"
+LOCK="$ROOT/static-deps.sha256"
+JOBS=${JOBS:-$(nproc)}
+
+ZLIB_VERSION=1.3.1
+LIBPNG_VERSION=1.6.43
+FREETYPE_VERSION=2.13.2
+EXPAT_VERSION=2.6.2
+FONTCONFIG_VERSION=2.15.0
+PIXMAN_VERSION=0.43.4
+CAIRO_VERSION=1.18.0
+
+for tool in gcc g++ make meson ninja curl pkg-config; do
+    if ! command -v "$tool" > /dev/null; then
+        echo "Error: $tool not found (required for the static text2png build)"
+        exit 1
+    fi
+done
+
+TARBALLS="zlib-$ZLIB_VERSION.tar.gz libpng-$LIBPNG_VERSION.tar.xz freetype-$FREETYPE_VERSION.tar.xz
+expat-$EXPAT_VERSION.tar.xz fontconfig-$FONTCONFIG_VERSION.tar.xz pixman-$PIXMAN_VERSION.tar.gz
+cairo-$CAIRO_VERSION.tar.xz"
+
+# Every pinned tarball needs a checksum before anything is downloaded
+if [ "${UPDATE_LOCK:-0}" != 1 ]; then
+    for file in $TARBALLS; do
+        if ! awk -v f="$file" '$2 == f { found = 1 } END { exit !found }' "$LOCK" 2> /dev/null; then
+            echo "Error: no checksum for $file in $(basename "$LOCK")"
+            echo "Verify the tarball upstream and record it with UPDATE_LOCK=1 $0"
+            echo "(static-deps.sha256 holds no verified sums yet; see \"Static text2png\" in README.md)"
+            exit 1
+        fi
+    done
+fi
+
+mkdir -p "$SRC" "$PREFIX" bin
+
+export LC_ALL=C TZ=UTC
+export SOURCE_DATE_EPOCH=${SOURCE_DATE_EPOCH:-$(git -C "$ROOT" log -1 --format=%ct 2>/dev/null || echo 0)}
+export CFLAGS="-O2 -fPIC -ffile-prefix-map=$WORK=."
+export CXXFLAGS="$CFLAGS"
+export AR_FLAGS=crD
+export PKG_CONFIG_PATH="$PREFIX/lib/pkgconfig"
+export PKG_CONFIG_LIBDIR="$PREFIX/lib/pkgconfig"
+export PATH="$PREFIX/bin:$PATH"
+
+# fetch URL -> unpacked source directory name on stdout
+fetch() {
+    local url=$1 file
+    file=$(basename "$url")
+    if [ ! -f "$SRC/$file" ]; then
+        echo "Downloading $file..." >&2
+        curl -fL --retry 3 -o "$SRC/$file.part" "$url"
+        mv "$SRC/$file.part" "$SRC/$file"
+    fi
+    local sum
+    sum=$(sha256sum "$SRC/$file" | cut -d' ' -f1)
+    local want
+    want=$(awk -v f="$file" '$2 == f { print $1 }' "$LOCK")
+    if [ -z "$want" ] && [ "${UPDATE_LOCK:-0}" = 1 ]; then
+        echo "$sum  $file" >> "$LOCK"
+        echo "Recorded checksum for $file in $(basename "$LOCK"): $sum" >&2
+    elif [ -z "$want" ]; then
+        echo "Error: no checksum for $file in $(basename "$LOCK")" >&2
+        exit 1
+    elif [ "$want" != "$sum" ]; then
+        echo "Error: checksum mismatch for $file (expected $want, got $sum)" >&2
+        exit 1
+    fi
+    tar -xf "$SRC/$file" -C "$SRC"
+    echo "$SRC/$(tar -tf "$SRC/$file" | head -1 | cut -d/ -f1)"
+}
+
+autotools() {
+    local dir=$1; shift
+    (cd "$dir" && ./configure --prefix="$PREFIX" --enable-static --disable-shared "$@" > /dev/null \
+        && make -j"$JOBS" > /dev/null && make install > /dev/null)
+}
+
+mesonbuild() {
+    local dir=$1; shift
+    meson setup "$dir/_build" "$dir" --prefix="$PREFIX" --libdir=lib --buildtype=release \
+        --default-library=static --prefer-static --wrap-mode=nofallback "$@" > /dev/null
+    ninja -C "$dir/_build" -j"$JOBS" install > /dev/null
+}
+
+echo "Building zlib $ZLIB_VERSION..."
+dir=$(fetch "https://zlib.net/fossils/zlib-$ZLIB_VERSION.tar.gz")
+(cd "$dir" && ./configure --prefix="$PREFIX" --static > /dev/null && make -j"$JOBS" > /dev/null && make install > /dev/null)
+
+echo "Building libpng $LIBPNG_VERSION..."
+dir=$(fetch "https://download.sourceforge.net/libpng/libpng-$LIBPNG_VERSION.tar.xz")
+autotools "$dir" CPPFLAGS="-I$PREFIX/include" LDFLAGS="-L$PREFIX/lib"
+
+echo "Building freetype $FREETYPE_VERSION..."
+dir=$(fetch "https://download.savannah.gnu.org/releases/freetype/freetype-$FREETYPE_VERSION.tar.xz")
+autotools "$dir" --with-zlib=yes --with-png=yes --with-harfbuzz=no --with-bzip2=no --with-brotli=no
+
+echo "Building expat $EXPAT_VERSION..."
+dir=$(fetch "https://github.com/libexpat/libexpat/releases/download/R_${EXPAT_VERSION//./_}/expat-$EXPAT_VERSION.tar.xz")
+autotools "$dir" --without-docbook --without-examples --without-tests
+
+# Use the host's font configuration and cache directories at runtime
+echo "Building fontconfig $FONTCONFIG_VERSION..."
+dir=$(fetch "https://www.freedesktop.org/software/fontconfig/release/fontconfig-$FONTCONFIG_VERSION.tar.xz")
+autotools "$dir" --sysconfdir=/etc --localstatedir=/var --disable-docs --disable-nls --disable-cache-build
+
+echo "Building pixman $PIXMAN_VERSION..."
+dir=$(fetch "https://www.cairographics.org/releases/pixman-$PIXMAN_VERSION.tar.gz")
+mesonbuild "$dir" -Dtests=disabled -Ddemos=disabled -Dgtk=disabled -Dlibpng=disabled
+
+echo "Building cairo $CAIRO_VERSION..."
+dir=$(fetch "https://www.cairographics.org/releases/cairo-$CAIRO_VERSION.tar.xz")
+mesonbuild "$dir" -Dxlib=disabled -Dxcb=disabled -Dquartz=disabled -Dglib=disabled -Dspectre=disabled \
+    -Dsymbol-lookup=disabled -Dtests=disabled -Dgtk_doc=false -Dlzo=disabled \
+    -Dpng=enabled -Dfreetype=enabled -Dfontconfig=enabled -Dzlib=enabled
+
+echo "Linking bin/text2png-static..."
+g++ -std=gnu++17 -O2 -Wall -Wextra -pthread -static -ffile-prefix-map="$ROOT"=. -Wl,--build-id=sha1 \
+    -o bin/text2png-static "$ROOT/text2png.cpp" \
+    $(pkg-config --static --cflags --libs cairo fontconfig freetype2 libpng)
+strip --strip-all bin/text2png-static
+
+echo "Static build completed successfully!"
+sha256sum bin/text2png-static
+
+if ldd bin/text2png-static 2>&1 | grep -q "not a dynamic executable\|statically linked"; then
+    echo "Verification: Executable is statically linked"
+else
+    echo "Warning: Executable may not be fully static"
+fi
+echo "Compare startup against the dynamic build with: tigstartup bin/text2png bin/text2png-static"
@@ -26,12 +26,12 @@ echo ""
 if [ ! -f "bin/text2png" ]; then
     echo "Building Cairo-based text2png executable..."
     # Try to compile with Cairo
-    if command -v pkg-config &> /dev/null && pkg-config --exists cairo && pkg-config --exists fontconfig && pkg-config --exists freetype2; then
-        g++ -o bin/text2png text2png.cpp `pkg-config --cflags --libs cairo fontconfig freetype2` && \
+    if command -v pkg-config &> /dev/null && pkg-config --exists cairo && pkg-config --exists fontconfig && pkg-config --exists freetype2 && pkg-config --exists libpng; then
+        g++ -std=gnu++17 -O2 -pthread -o bin/text2png text2png.cpp `pkg-config --cflags --libs cairo fontconfig freetype2 libpng` && \
         echo "Cairo-based text2png compiled successfully!" || \
         echo "Failed to compile Cairo-based text2png - missing Cairo dependencies?"
     else
-        echo "Error: Cairo dependencies not found. Please install: cairo, fontconfig, and freetype2 development packages."
+        echo "Error: Cairo dependencies not found. Please install: cairo, fontconfig, freetype2, and libpng development packages."
         rm -rf "$TEST_DIR"
         exit 1
     fi
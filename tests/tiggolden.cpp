@@ -0,0 +1,306 @@
+// tiggolden.cpp
+// Build: via CMake (ctest runs it as the "golden" test), or
+//        g++ -std=gnu++17 -O2 -Wall -Wextra -I. -o tiggolden tests/tiggolden.cpp `pkg-config --cflags --libs libpng`
+// Purpose: Golden-image regression test for text2png. Renders every case in
+//          tests/golden/cases.tsv and compares the PNG against tests/golden/<name>.png.
+// Features:
+//  - Per-channel tolerance diff (RGBA, straight alpha) through the tig_simd.h
+//    kernels, so large corpora stay cheap to check. --simd LEVEL pins both the
+//    diff kernel and text2png's own kernels, to check every path bit-for-bit.
+//  - On mismatch writes <out-dir>/<name>-diff.png: a heatmap of the per-pixel
+//    maximum channel delta (black = identical, yellow = largest error).
+//  - --update rewrites the golden PNGs from the current text2png.
+//  - Exits 77 (ctest "skipped") only when text2png is missing; a case
+//    without a golden PNG fails, so the test never passes vacuously.
+//
+// License: MIT
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include <png.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "tig_simd.h"
+
+#if defined(_WIN32)
+#error "This tool targets Linux/Unix environments."
+#endif
+
+namespace {
+
+constexpr int kSkipped = 77;  // ctest SKIP_RETURN_CODE
+
+// ---------------------------------------------------------------------------
+// PNG I/O (libpng simplified API, always 8-bit RGBA)
+// ---------------------------------------------------------------------------
+
+struct Image {
+    uint32_t width = 0, height = 0;
+    std::vector<uint8_t> rgba;
+};
+
+bool read_png(const std::string& path, Image& img) {
+    png_image png;
+    std::memset(&png, 0, sizeof(png));
+    png.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&png, path.c_str())) return false;
+    png.format = PNG_FORMAT_RGBA;
+    img.width = png.width;
+    img.height = png.height;
+    img.rgba.resize(PNG_IMAGE_SIZE(png));
+    if (!png_image_finish_read(&png, nullptr, img.rgba.data(), 0, nullptr)) {
+        png_image_free(&png);
+        return false;
+    }
+    return true;
+}
+
+bool write_png(const std::string& path, const Image& img) {
+    png_image png;
+    std::memset(&png, 0, sizeof(png));
+    png.version = PNG_IMAGE_VERSION;
+    png.width = img.width;
+    png.height = img.height;
+    png.format = PNG_FORMAT_RGBA;
+    return png_image_write_to_file(&png, path.c_str(), 0, img.rgba.data(), 0, nullptr) != 0;
+}
+
+// Heatmap of per-pixel max channel delta: black -> red -> yellow.
+Image make_heatmap(const Image& ref, const std::vector<uint8_t>& delta) {
+    Image out;
+    out.width = ref.width;
+    out.height = ref.height;
+    out.rgba.resize(delta.size());
+    uint8_t peak = 1;
+    for (uint8_t d : delta) peak = std::max(peak, d);
+    for (size_t p = 0; p + 3 < delta.size(); p += 4) {
+        uint8_t d = std::max(std::max(delta[p], delta[p + 1]), std::max(delta[p + 2], delta[p + 3]));
+        unsigned v = d * 510u / peak;  // 0..510 over the two ramps
+        out.rgba[p + 0] = static_cast<uint8_t>(std::min(v, 255u));
+        out.rgba[p + 1] = static_cast<uint8_t>(v > 255 ? v - 255 : 0);
+        out.rgba[p + 2] = 0;
+        out.rgba[p + 3] = 255;
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// Cases
+// ---------------------------------------------------------------------------
+
+struct Case {
+    std::string name;
+    std::string text;
+    std::vector<std::string> args;
+};
+
+// Split an option string on spaces, honouring "double quotes".
+std::vector<std::string> split_args(const std::string& s) {
+    std::vector<std::string> out;
+    std::string cur;
+    bool quoted = false, have = false;
+    for (char c : s) {
+        if (c == '"') { quoted = !quoted; have = true; }
+        else if (c == ' ' && !quoted) {
+            if (have) out.push_back(cur);
+            cur.clear();
+            have = false;
+        } else { cur += c; have = true; }
+    }
+    if (have) out.push_back(cur);
+    return out;
+}
+
+bool load_cases(const std::string& path, std::vector<Case>& cases) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream iss(line);
+        Case c;
+        std::string opts;
+        if (!std::getline(iss, c.name, '\t') || !std::getline(iss, c.text, '\t')) continue;
+        std::getline(iss, opts);
+        c.args = split_args(opts);
+        cases.push_back(c);
+    }
+    return true;
+}
+
+int run_text2png(const std::string& exe, const std::string& input, const std::string& prefix,
+                 const std::vector<std::string>& args) {
+    std::vector<std::string> av{exe, input, prefix};
+    av.insert(av.end(), args.begin(), args.end());
+    std::vector<char*> cargv;
+    for (auto& a : av) cargv.push_back(const_cast<char*>(a.c_str()));
+    cargv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        if (!freopen("/dev/null", "w", stdout)) _exit(127);
+        execv(cargv[0], cargv.data());
+        _exit(127);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+struct Options {
+    std::string text2png;
+    std::string golden_dir = "tests/golden";
+    std::string out_dir = "golden-out";
+    int tolerance = 2;            // max per-channel delta treated as equal
+    double max_bad_ratio = 0.0;   // fraction of channel values allowed over tolerance
+    std::string simd = "auto";    // kernel level for the diff and for text2png
+    bool update = false;
+};
+
+void print_help(const char* argv0) {
+    std::cout << "Usage:\n"
+              << "  " << argv0 << " --text2png PATH [options]\n\n"
+              << "Options:\n"
+              << "  --text2png PATH         text2png executable under test\n"
+              << "  --golden-dir DIR        Directory with cases.tsv and golden PNGs (default: tests/golden)\n"
+              << "  --out-dir DIR           Rendered images and diff heatmaps (default: golden-out)\n"
+              << "  --tolerance N           Per-channel delta treated as equal (default: 2)\n"
+              << "  --max-bad-ratio R       Allowed fraction of channels over tolerance (default: 0)\n"
+              << "  --simd LEVEL            auto|scalar|sse4|avx2|avx512, also passed to text2png (default: auto)\n"
+              << "  --update                Overwrite golden PNGs with the current output\n"
+              << "  --help                  Show this help\n";
+}
+
+bool parse_args(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto need_val = [&](const char* flag) {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << flag << "\n";
+                return false;
+            }
+            return true;
+        };
+
+        if (a == "--help" || a == "-h") { print_help(argv[0]); std::exit(0); }
+        else if (a == "--text2png") { if (!need_val("--text2png")) return false; opt.text2png = argv[++i]; }
+        else if (a == "--golden-dir") { if (!need_val("--golden-dir")) return false; opt.golden_dir = argv[++i]; }
+        else if (a == "--out-dir") { if (!need_val("--out-dir")) return false; opt.out_dir = argv[++i]; }
+        else if (a == "--tolerance") { if (!need_val("--tolerance")) return false; opt.tolerance = std::stoi(argv[++i]); }
+        else if (a == "--max-bad-ratio") { if (!need_val("--max-bad-ratio")) return false; opt.max_bad_ratio = std::stod(argv[++i]); }
+        else if (a == "--simd") { if (!need_val("--simd")) return false; opt.simd = argv[++i]; }
+        else if (a.compare(0, 7, "--simd=") == 0) { opt.simd = a.substr(7); }
+        else if (a == "--update") { opt.update = true; }
+        else {
+            std::cerr << "Unknown option: " << a << "\n";
+            return false;
+        }
+    }
+    if (opt.text2png.empty()) {
+        std::cerr << "Error: --text2png PATH required\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        std::cerr << "Use --help for usage.\n";
+        return 2;
+    }
+    if (access(opt.text2png.c_str(), X_OK) != 0) {
+        std::cout << "SKIP: text2png not found at " << opt.text2png << "\n";
+        return kSkipped;
+    }
+
+    std::vector<Case> cases;
+    if (!load_cases(opt.golden_dir + "/cases.tsv", cases) || cases.empty()) {
+        std::cerr << "Error: no cases in " << opt.golden_dir << "/cases.tsv\n";
+        return 2;
+    }
+    mkdir(opt.out_dir.c_str(), 0755);
+
+    if (!tig_simd_select(opt.simd)) {
+        std::cerr << "Error: unknown --simd level: " << opt.simd << "\n";
+        return 2;
+    }
+    const TigKernels& kernels = tig_kernels();
+    std::cout << "golden: " << cases.size() << " cases, tolerance " << opt.tolerance
+              << ", kernel " << tig_simd_name(kernels.level) << "\n";
+
+    int passed = 0, failed = 0, missing = 0;
+    for (const Case& c : cases) {
+        const std::string input = opt.out_dir + "/" + c.name + ".txt";
+        const std::string prefix = opt.out_dir + "/" + c.name + "-";
+        const std::string rendered = prefix + "1.png";
+        const std::string golden = opt.golden_dir + "/" + c.name + ".png";
+        {
+            std::ofstream f(input, std::ios::trunc);
+            f << c.text << "\n";
+        }
+        unlink(rendered.c_str());
+
+        Image got, ref;
+        std::vector<std::string> args = c.args;
+        args.insert(args.end(), {"--simd", opt.simd});
+        int rc = run_text2png(opt.text2png, input, prefix, args);
+        if (rc != 0 || !read_png(rendered, got)) {
+            std::cout << "FAIL " << c.name << ": text2png produced no image (exit " << rc << ")\n";
+            ++failed;
+            continue;
+        }
+        if (opt.update) {
+            if (!write_png(golden, got)) {
+                std::cerr << "Error: cannot write " << golden << "\n";
+                return 2;
+            }
+            std::cout << "updated " << golden << "\n";
+            continue;
+        }
+        if (!read_png(golden, ref)) {
+            std::cout << "MISSING " << c.name << ": no golden at " << golden
+                      << " (run the golden-update target)\n";
+            ++missing;
+            continue;
+        }
+        if (got.width != ref.width || got.height != ref.height) {
+            std::cout << "FAIL " << c.name << ": size " << got.width << "x" << got.height
+                      << ", expected " << ref.width << "x" << ref.height << "\n";
+            ++failed;
+            continue;
+        }
+
+        std::vector<uint8_t> delta(ref.rgba.size());
+        size_t over = kernels.absdiff_count(got.rgba.data(), ref.rgba.data(), delta.data(), delta.size(),
+                           static_cast<uint8_t>(std::clamp(opt.tolerance, 0, 255)));
+        double ratio = delta.empty() ? 0.0 : static_cast<double>(over) / delta.size();
+        if (over > 0 && ratio > opt.max_bad_ratio) {
+            const std::string heat = opt.out_dir + "/" + c.name + "-diff.png";
+            write_png(heat, make_heatmap(ref, delta));
+            std::cout << "FAIL " << c.name << ": " << over << " channel values over tolerance ("
+                      << ratio * 100.0 << "%), heatmap " << heat << "\n";
+            ++failed;
+        } else {
+            ++passed;
+        }
+    }
+
+    if (opt.update) return failed ? 1 : 0;
+    std::cout << passed << " passed, " << failed << " failed, " << missing << " missing golden\n";
+    return failed || missing ? 1 : 0;
+}
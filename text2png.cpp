@@ -1,7 +1,7 @@
 /*
  * text2png - Convert text to transparent PNG images using Cairo
  * 
- * Compile with: g++ -o text2png text2png.cpp `pkg-config --cflags --libs cairo`
+ * Compile with: g++ -o text2png text2png.cpp `pkg-config --cflags --libs cairo fontconfig freetype2 libpng`
  */
 
 #include <cairo.h>
@@ -12,8 +12,32 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <dirent.h>
+
+#include "tig_anim.h"
+#include "tig_blur.h"
+#include "tig_checkpoint.h"
+#include "tig_effects.h"
+#include "tig_karaoke.h"
+#include "tig_manifest.h"
+#include "tig_png.h"
+#include "tig_probes.h"
+#include "tig_progress.h"
+#include "tig_queue.h"
+#include "tig_schedule.h"
+#include "tig_shard.h"
+#include "tig_simd.h"
+#include "tig_stats.h"
 
 struct TextOptions {
     std::string font_name = "DejaVu Sans";
@@ -22,11 +46,65 @@ struct TextOptions {
     double outline_r = 0.0, outline_g = 0.0, outline_b = 0.0;  // Black outline
     double bg_r = 0.0, bg_g = 0.0, bg_b = 0.0, bg_a = 0.0;  // Background: transparent by default
     int outline_width = 2;
+    bool gradient = false;  // --gradient: fill fades from the text color to this one, top to bottom
+    double gradient_r = 1.0, gradient_g = 1.0, gradient_b = 1.0;
     int padding = 20;
     std::string output_prefix = "output";
     bool verbose = false;  // Added verbose flag
+    bool stats = false;    // Print timing/memory summary at exit
+    bool quiet = false;    // Suppress the per-line "Created:" log
+    bool progress = false; // Periodic progress line on stderr
+    std::vector<std::string> scales;  // --scales factors as given; empty = one 1x output, no suffix
+    int proxy = 0;              // --proxy N: render at 1/N with fast antialiasing and PNG level 1; 0 = off
+    bool finalize = false;      // Re-render the proxy outputs listed in the manifest at full quality
+    int png_compression = -1;   // zlib level 0-9; -1 = libpng default
+    std::string manifest;       // JSON Lines record of written files; empty = none
+    TigShard shard;             // --shard I/N: render only this node's share of the lines
+    std::string queue;          // --queue DIR: take chunks of lines from a shared claim queue
+    int queue_chunk = 32;       // lines per queue chunk
+    int queue_lease = 300;      // seconds before an unrenewed claim is taken over
+    bool checkpoint = false;    // journal finished lines to <prefix>checkpoint.jsonl
+    bool resume = false;        // skip the lines the journal lists with intact outputs
+    int jobs = 1;               // lines rendered at once (the most, with jobs_auto)
+    bool jobs_auto = false;     // --jobs auto: start at the CPU budget, adapt to throughput and memory
+    bool longest_first = true;  // --jobs: dispatch the most expensive lines first
+    bool karaoke = false;       // Input lines carry LRC/ASS timing; write highlight frames
+    int fps = 25;               // Karaoke frame rate
+    double hl_r = 1.0, hl_g = 1.0, hl_b = 0.0;  // Karaoke highlight text: yellow
+    double hl_outline_r = 0.0, hl_outline_g = 0.0, hl_outline_b = 0.0;
+    bool hl_outline_set = false;  // otherwise the highlight keeps the outline color
+    bool delta = false;           // frame sequences: write only what changed per frame
+    std::string burn_in;          // directory of PNG frames, or "-" for raw RGBA on stdin
+    int frame_width = 0, frame_height = 0;  // raw burn-in frame size
+    std::string burn_position = "bottom";   // top|center|bottom
+    TigBlurEffect shadow;         // --shadow
+    TigBlurEffect glow;           // --glow
+    bool linear_blend = false;    // composite edges and effects in linear light
+    TigAnimation anim;            // --animate effects, --frames, --easing
+    std::string anim_format = "png";  // png (one file per frame), apng or raw
+    std::string variant_name;         // set on entries of variants
+    std::vector<TextOptions> variants;  // --variant style blocks; empty = render this style only
 };
 
+// Copies the per-variant style fields (colors, outline width).
+void copy_style(const TextOptions& from, TextOptions& to) {
+    to.text_r = from.text_r;
+    to.text_g = from.text_g;
+    to.text_b = from.text_b;
+    to.outline_r = from.outline_r;
+    to.outline_g = from.outline_g;
+    to.outline_b = from.outline_b;
+    to.bg_r = from.bg_r;
+    to.bg_g = from.bg_g;
+    to.bg_b = from.bg_b;
+    to.bg_a = from.bg_a;
+    to.outline_width = from.outline_width;
+    to.gradient = from.gradient;
+    to.gradient_r = from.gradient_r;
+    to.gradient_g = from.gradient_g;
+    to.gradient_b = from.gradient_b;
+}
+
 void print_final_config(const TextOptions& opts) {
     std::cout << "\n=== Final Configuration ===" << std::endl;
     std::cout << "Font Name: " << opts.font_name << std::endl;
@@ -40,14 +118,80 @@ void print_final_config(const TextOptions& opts) {
               << static_cast<int>(opts.outline_g * 255) << "," 
               << static_cast<int>(opts.outline_b * 255) << ")" << std::endl;
     std::cout << "Outline Width: " << opts.outline_width << std::endl;
+    if (opts.gradient) {
+        std::cout << "Gradient To: RGB(" << static_cast<int>(opts.gradient_r * 255) << ","
+                  << static_cast<int>(opts.gradient_g * 255) << "," << static_cast<int>(opts.gradient_b * 255) << ")"
+                  << std::endl;
+    }
     std::cout << "Background Color: RGBA(" 
               << static_cast<int>(opts.bg_r * 255) << "," 
               << static_cast<int>(opts.bg_g * 255) << "," 
               << static_cast<int>(opts.bg_b * 255) << "," 
               << static_cast<int>(opts.bg_a * 255) << ")" << std::endl;
     std::cout << "Padding: " << opts.padding << std::endl;
+    std::cout << "SIMD Kernels: " << tig_simd_name(tig_kernels().level) << std::endl;
     std::cout << "Verbose Mode: " << (opts.verbose ? "ON" : "OFF") << std::endl;
     std::cout << "Output Prefix: " << opts.output_prefix << std::endl;
+    for (const TextOptions& v : opts.variants) {
+        std::cout << "Variant " << v.variant_name << ": text RGB("
+                  << static_cast<int>(v.text_r * 255) << "," << static_cast<int>(v.text_g * 255) << ","
+                  << static_cast<int>(v.text_b * 255) << "), outline RGB("
+                  << static_cast<int>(v.outline_r * 255) << "," << static_cast<int>(v.outline_g * 255) << ","
+                  << static_cast<int>(v.outline_b * 255) << ") width " << v.outline_width
+                  << ", bg alpha " << static_cast<int>(v.bg_a * 255);
+        if (v.gradient) {
+            std::cout << ", gradient to RGB(" << static_cast<int>(v.gradient_r * 255) << ","
+                      << static_cast<int>(v.gradient_g * 255) << "," << static_cast<int>(v.gradient_b * 255) << ")";
+        }
+        std::cout << std::endl;
+    }
+    if (opts.proxy > 0) std::cout << "Proxy: 1/" << opts.proxy << std::endl;
+    if (opts.finalize) std::cout << "Finalize: ON" << std::endl;
+    if (opts.png_compression >= 0) std::cout << "PNG Compression: " << opts.png_compression << std::endl;
+    if (!opts.manifest.empty()) std::cout << "Manifest: " << opts.manifest << std::endl;
+    if (opts.shard.count > 1) {
+        std::cout << "Shard: " << opts.shard.index << "/" << opts.shard.count << " ("
+                  << (opts.shard.contiguous ? "contiguous" : "round-robin") << ")" << std::endl;
+    }
+    if (opts.jobs > 1) {
+        std::cout << "Jobs: ";
+        if (opts.jobs_auto) std::cout << "auto, " << tig_cpu_budget() << " to start, up to " << opts.jobs;
+        else std::cout << opts.jobs;
+        std::cout << " (" << (opts.longest_first ? "longest-first" : "input order") << ")" << std::endl;
+    }
+    if (opts.checkpoint) std::cout << "Checkpoint: " << (opts.resume ? "resume" : "ON") << std::endl;
+    if (!opts.queue.empty()) {
+        std::cout << "Queue: " << opts.queue << " (" << opts.queue_chunk << " lines per chunk, lease "
+                  << opts.queue_lease << "s)" << std::endl;
+    }
+    if (opts.anim.effects) {
+        std::cout << "Animation: " << opts.anim.frames << " frames as " << opts.anim_format << std::endl;
+    }
+    if (opts.shadow.enabled) {
+        std::cout << "Shadow: offset " << opts.shadow.dx << "," << opts.shadow.dy << ", radius " << opts.shadow.radius
+                  << ", RGBA(" << int(opts.shadow.r) << "," << int(opts.shadow.g) << "," << int(opts.shadow.b) << ","
+                  << int(opts.shadow.a) << ")" << std::endl;
+    }
+    if (opts.glow.enabled) {
+        std::cout << "Glow: radius " << opts.glow.radius << ", RGBA(" << int(opts.glow.r) << "," << int(opts.glow.g)
+                  << "," << int(opts.glow.b) << "," << int(opts.glow.a) << ")" << std::endl;
+    }
+    if (opts.linear_blend) std::cout << "Linear-light Blending: ON" << std::endl;
+    if (opts.delta) std::cout << "Delta Frames: ON" << std::endl;
+    if (!opts.burn_in.empty()) {
+        std::cout << "Burn-in: " << opts.burn_in << " at " << opts.fps << " fps, " << opts.burn_position;
+        if (opts.frame_width) std::cout << ", " << opts.frame_width << "x" << opts.frame_height;
+        std::cout << std::endl;
+    }
+    if (opts.karaoke) {
+        std::cout << "Karaoke: " << opts.fps << " fps, highlight RGB(" << static_cast<int>(opts.hl_r * 255) << ","
+                  << static_cast<int>(opts.hl_g * 255) << "," << static_cast<int>(opts.hl_b * 255) << ")" << std::endl;
+    }
+    if (!opts.scales.empty()) {
+        std::cout << "Scales: ";
+        for (size_t i = 0; i < opts.scales.size(); ++i) std::cout << (i ? "," : "") << opts.scales[i];
+        std::cout << std::endl;
+    }
     std::cout << "==========================\n" << std::endl;
 }
 
@@ -93,12 +237,968 @@ void list_fonts() {
     FcConfigDestroy(config);
 }
 
-void render_text_to_png(const std::string& text, const std::string& filename, const TextOptions& opts) {
-    // Initialize FreeType and FontConfig
-    FT_Library ft_library;
-    if (FT_Init_FreeType(&ft_library)) {
+// Writes buffer to filename; returns false (and reports) on any I/O error.
+static bool write_file(const std::string& filename, const std::vector<unsigned char>& buffer) {
+    FILE* file = fopen(filename.c_str(), "wb");
+    bool ok = file && fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    if (file && fclose(file) != 0) ok = false;
+    if (!ok) std::cerr << "Error writing PNG: " << filename << std::endl;
+    return ok;
+}
+
+// Per-job render state: the font is resolved and loaded once, and the render
+// path is specialized for the style once, instead of per line.
+struct RenderJob;
+struct RenderedFile;
+using RenderFn = size_t (*)(const RenderJob& job, const std::string& text, int line_number,
+                            std::vector<RenderedFile>& files);
+
+// One image a line produced (appended by the render path); bytes is 0 if
+// encoding or writing it failed. --delta frames may be a changed rectangle
+// at (x, y), or nothing at all if the frame equals the previous one.
+struct RenderedFile {
+    std::string filename;
+    int width = 0;
+    int height = 0;
+    size_t bytes = 0;
+    bool delta = false;
+    int x = 0, y = 0;
+    std::string same_as;  // set when no file was written for this frame
+
+    RenderedFile() = default;
+    RenderedFile(const std::string& name, int w, int h, size_t size)
+        : filename(name), width(w), height(h), bytes(size) {}
+
+    bool failed() const { return bytes == 0 && same_as.empty(); }
+};
+
+// One output size. The scaled font's CTM is the scale, so glyphs are hinted
+// and cached for the device size while positions come from the shared layout.
+struct OutputScale {
+    double factor = 1.0;
+    std::string suffix;  // "" or "@<scale>"
+    cairo_scaled_font_t* font = nullptr;
+};
+
+struct RenderJob {
+    const TextOptions* opts = nullptr;
+    cairo_font_face_t* font_face = nullptr;
+    cairo_font_options_t* font_opts = nullptr;
+    cairo_scaled_font_t* scaled_font = nullptr;  // 1x, used for layout
+    std::vector<OutputScale> outputs;
+    std::vector<std::string> suffixes;  // one per file a line produces (variant x scale)
+    int max_outline_width = 0;          // canvas margin shared by all variants
+    double effect_margin = 0.0;         // 1x canvas margin for --shadow/--glow
+    cairo_antialias_t antialias = CAIRO_ANTIALIAS_DEFAULT;  // for outline paths
+    int png_compression = -1;
+    TextOptions highlight;  // --karaoke highlight style
+    std::string font_file;  // resolved by FontConfig
+    RenderFn render = nullptr;
+    std::string path_name;
+
+    RenderJob() = default;
+    RenderJob(const RenderJob&) = delete;
+    RenderJob& operator=(const RenderJob&) = delete;
+    ~RenderJob() {
+        for (OutputScale& out : outputs) {
+            if (out.font) cairo_scaled_font_destroy(out.font);
+        }
+        if (scaled_font) cairo_scaled_font_destroy(scaled_font);
+        if (font_face) cairo_font_face_destroy(font_face);
+        if (font_opts) cairo_font_options_destroy(font_opts);
+    }
+};
+
+// Glyph run and ink extents of one line, at origin (0, 0). clusters maps
+// text bytes to glyphs when requested from layout_text().
+struct TextLayout {
+    std::vector<cairo_glyph_t> glyphs;
+    std::vector<cairo_text_cluster_t> clusters;
+    cairo_text_extents_t extents;
+};
+
+// Called by cairo when the last reference to the font face goes away (its
+// scaled-font cache can outlive RenderJob), so the FT_Face lives exactly as long.
+static void release_ft_face(void* face) {
+    FT_Done_Face(static_cast<FT_Face>(face));
+}
+
+// Shapes text with the job's scaled font into layout (buffers reused across lines).
+static bool layout_text(const RenderJob& job, const std::string& text, TextLayout& layout,
+                        bool want_clusters = false) {
+    if (layout.glyphs.size() < text.size() + 1) layout.glyphs.resize(text.size() + 1);
+    cairo_glyph_t* glyphs = layout.glyphs.data();
+    int num_glyphs = static_cast<int>(layout.glyphs.size());
+    cairo_text_cluster_t* clusters = nullptr;
+    int num_clusters = 0;
+    cairo_text_cluster_flags_t cluster_flags;
+    if (want_clusters) {
+        if (layout.clusters.size() < text.size() + 1) layout.clusters.resize(text.size() + 1);
+        clusters = layout.clusters.data();
+        num_clusters = static_cast<int>(layout.clusters.size());
+    }
+    cairo_status_t status = cairo_scaled_font_text_to_glyphs(
+        job.scaled_font, 0, 0, text.c_str(), static_cast<int>(text.size()), &glyphs, &num_glyphs,
+        want_clusters ? &clusters : nullptr, want_clusters ? &num_clusters : nullptr,
+        want_clusters ? &cluster_flags : nullptr);
+    if (status != CAIRO_STATUS_SUCCESS) return false;
+    if (glyphs != layout.glyphs.data()) {  // cairo needed a bigger buffer
+        layout.glyphs.assign(glyphs, glyphs + num_glyphs);
+        cairo_glyph_free(glyphs);
+    }
+    layout.glyphs.resize(static_cast<size_t>(num_glyphs));
+    if (want_clusters) {
+        if (clusters != layout.clusters.data()) {
+            layout.clusters.assign(clusters, clusters + num_clusters);
+            cairo_text_cluster_free(clusters);
+        }
+        layout.clusters.resize(static_cast<size_t>(num_clusters));
+    }
+    cairo_scaled_font_glyph_extents(job.scaled_font, layout.glyphs.data(), num_glyphs, &layout.extents);
+    return true;
+}
+
+// Computes the 1x image size for a laid-out line and moves its glyphs into
+// place. outline_width is the widest outline the canvas has to fit, margin
+// extra room on every side (for shadow and glow).
+static void place_layout(const TextOptions& opts, int outline_width, TextLayout& layout,
+                         double& full_width, double& full_height, double margin = 0.0) {
+    // Calculate image dimensions properly
+    // extents.width and extents.height may not include the full character bounds
+    // For outline text, account for the outline width too
+    const cairo_text_extents_t& extents = layout.extents;
+    double bearing_x = extents.x_bearing;
+    double bearing_y = extents.y_bearing;
+
+    // Determine the full dimensions needed
+    full_width = std::abs(bearing_x) + extents.width + opts.padding * 2 + outline_width * 2;
+    full_height = std::abs(bearing_y) + extents.height + opts.padding * 2 + outline_width * 2;
+
+    // Ensure minimum dimensions (in case of very short text)
+    if (full_width < opts.font_size * 1.5) // Just a reasonable minimum
+        full_width = opts.font_size * 1.5;
+    if (full_height < opts.font_size)
+        full_height = opts.font_size * 1.2;
+
+    full_width += margin * 2;
+    full_height += margin * 2;
+
+    // Position the text with proper alignment in the center of the image
+    double x_pos = margin + opts.padding + outline_width * 2 - bearing_x;  // Adjust for possible large outline
+    double y_pos = margin + opts.padding + outline_width * 2 - bearing_y + opts.font_size;  // Adjust for font baseline
+    for (cairo_glyph_t& g : layout.glyphs) {
+        g.x += x_pos;
+        g.y += y_pos;
+    }
+}
+
+// Relative cost of a line for --schedule longest-first, from a cheap pass
+// that keeps no glyph run: the canvas width (text advance plus padding)
+// plus a per-character term for shaping, times the frames a karaoke line
+// writes. Factors every line shares (height, variants, scales) are left out.
+static double estimate_line_cost(const RenderJob& job, const std::string& text) {
+    const TextOptions& opts = *job.opts;
+    const std::string* plain = &text;
+    double frames = 1.0;
+    static thread_local TigKaraokeLine karaoke;
+    if (opts.karaoke && tig_karaoke_parse(text, karaoke)) {
+        plain = &karaoke.text;
+        frames += std::max<int64_t>(0, karaoke.end_ms - karaoke.start_ms) * opts.fps / 1000.0;
+    }
+    cairo_text_extents_t extents;
+    cairo_scaled_font_text_extents(job.scaled_font, plain->c_str(), &extents);
+    return frames * (extents.x_advance + 2.0 * opts.padding + static_cast<double>(plain->size()));
+}
+
+// Hash of every option that shapes the written images, for the --checkpoint
+// journal header: a journal made with other options describes other files.
+// Options that only affect scheduling or reporting (--jobs, --progress,
+// --stats, ...) are left out, as are output names, which the records carry.
+static uint64_t render_options_hash(const RenderJob& job) {
+    const TextOptions& opts = *job.opts;
+    std::ostringstream key;
+    key.precision(17);
+    auto style = [&key](const TextOptions& o) {
+        key << o.variant_name << ' ' << o.text_r << ' ' << o.text_g << ' ' << o.text_b << ' ' << o.outline_r << ' '
+            << o.outline_g << ' ' << o.outline_b << ' ' << o.bg_r << ' ' << o.bg_g << ' ' << o.bg_b << ' ' << o.bg_a
+            << ' ' << o.outline_width << ' ' << o.gradient << ' ' << o.gradient_r << ' ' << o.gradient_g << ' '
+            << o.gradient_b << ';';
+    };
+    auto effect = [&key](const TigBlurEffect& e) {
+        key << e.enabled << ' ' << e.dx << ' ' << e.dy << ' ' << e.radius << ' ' << int(e.r) << ' ' << int(e.g) << ' '
+            << int(e.b) << ' ' << int(e.a) << ';';
+    };
+    key << job.font_file << ';' << opts.font_size << ' ' << opts.padding << ' ' << opts.proxy << ' '
+        << job.png_compression << ' ' << job.antialias << ' ' << tig_simd_name(tig_kernels().level) << ';'
+        << job.path_name << ';';  // the render path, e.g. a TIG_GLYPH_CACHE_FILL build
+    style(opts);
+    for (const TextOptions& v : opts.variants) style(v);
+    for (const std::string& scale : opts.scales) key << scale << ',';
+    key << ';' << opts.karaoke << ' ' << opts.fps << ' ' << opts.delta << ' ' << opts.linear_blend << ' '
+        << opts.anim.effects << ' ' << opts.anim.easing << ' ' << opts.anim.frames << ' ' << opts.anim_format << ';';
+    if (opts.karaoke) style(job.highlight);
+    effect(opts.shadow);
+    effect(opts.glow);
+    return tig_text_hash(key.str());
+}
+
+// <prefix><line><suffix>.png, e.g. out-12.png or out-12@1.5.png
+std::string output_filename(const TextOptions& opts, int line_number, const std::string& suffix) {
+    return opts.output_prefix + std::to_string(line_number) + suffix + ".png";
+}
+
+// Writes an encoded image and records it in files. Returns the bytes written, 0 on failure.
+static size_t write_output(const std::string& filename, const std::vector<unsigned char>& buffer, int width,
+                           int height, int line_number, TigStageScope& stage, std::vector<RenderedFile>& files) {
+    stage.next(TIG_STAGE_WRITE);
+    size_t written = write_file(filename, buffer) ? buffer.size() : 0;
+    TIG_PROBE2(write, line_number, written);
+    files.push_back({filename, width, height, written});
+    return written;
+}
+
+// Encodes surface to PNG in memory (buffer capacity is reused across lines),
+// then writes it and records it in files. With reuse_last the surface is
+// known to equal the one of the previous successful call, whose PNG is
+// written again. Returns the bytes written, 0 on failure.
+static size_t encode_and_write(const RenderJob& job, cairo_surface_t* surface, const std::string& filename,
+                               int line_number, TigStageScope& stage, std::vector<RenderedFile>& files,
+                               bool reuse_last = false) {
+    static thread_local std::vector<unsigned char> png;
+    stage.next(TIG_STAGE_ENCODE);
+    bool encoded = true;
+    if (!reuse_last) {
+        png.clear();
+        encoded = tig_png_encode(surface, png, job.png_compression);
+    }
+    TIG_PROBE2(encode, line_number, png.size());
+    const int width = cairo_image_surface_get_width(surface);
+    const int height = cairo_image_surface_get_height(surface);
+    if (!encoded) {
+        std::cerr << "Error encoding PNG: " << filename << std::endl;
+        files.push_back({filename, width, height, 0});
+        return 0;
+    }
+    return write_output(filename, png, width, height, line_number, stage, files);
+}
+
+// Bounding box of the pixels that differ between two ARGB32 frames of one
+// size (rows compared with the diff_span kernel). Returns false if equal.
+static bool dirty_rect(const unsigned char* prev, const unsigned char* cur, int width, int height, int stride,
+                       int& x, int& y, int& w, int& h) {
+    const TigKernels& kernels = tig_kernels();
+    int x0 = width, x1 = 0, y0 = -1, y1 = -1;
+    for (int row = 0; row < height; ++row) {
+        const size_t offset = static_cast<size_t>(row) * stride;
+        size_t end;
+        const size_t first = kernels.diff_span(reinterpret_cast<const uint32_t*>(prev + offset),
+                                               reinterpret_cast<const uint32_t*>(cur + offset),
+                                               static_cast<size_t>(width), &end);
+        if (end == 0) continue;
+        if (y0 < 0) y0 = row;
+        y1 = row;
+        x0 = std::min(x0, static_cast<int>(first));
+        x1 = std::max(x1, static_cast<int>(end));
+    }
+    if (y0 < 0) return false;
+    x = x0;
+    y = y0;
+    w = x1 - x0;
+    h = y1 - y0 + 1;
+    return true;
+}
+
+// Writes the PNG frames of one line's sequence (karaoke, --animate png).
+// With --delta the first frame is written whole and each later frame only as
+// the rectangle that changed since the previous one; an unchanged frame is
+// not written but recorded as the same as the last file. After a failed write
+// the next frame is written whole again.
+class FrameWriter {
+public:
+    FrameWriter(const RenderJob& job, int line_number, TigStageScope& stage, std::vector<RenderedFile>& files)
+        : job_(job), line_number_(line_number), stage_(stage), files_(files) {}
+
+    // unchanged: the caller knows frame equals the previous frame.
+    size_t write(cairo_surface_t* frame, const std::string& filename, bool unchanged) {
+        if (!job_.opts->delta) {
+            const size_t bytes = encode_and_write(job_, frame, filename, line_number_, stage_, files_,
+                                                  unchanged && last_ok_);
+            last_ok_ = bytes > 0;
+            return bytes;
+        }
+
+        const int width = cairo_image_surface_get_width(frame);
+        const int height = cairo_image_surface_get_height(frame);
+        const int stride = cairo_image_surface_get_stride(frame);
+        unsigned char* data = cairo_image_surface_get_data(frame);
+        static thread_local std::vector<unsigned char> prev;
+        int x = 0, y = 0, w = width, h = height;
+        if (!last_file_.empty()) {
+            stage_.next(TIG_STAGE_RASTER);
+            if (unchanged || !dirty_rect(prev.data(), data, width, height, stride, x, y, w, h)) {
+                RenderedFile same(filename, width, height, 0);
+                same.same_as = last_file_;
+                files_.push_back(same);
+                return 0;
+            }
+        }
+
+        size_t bytes;
+        if (w == width && h == height) {
+            bytes = encode_and_write(job_, frame, filename, line_number_, stage_, files_);
+        } else {
+            cairo_surface_t* rect = cairo_image_surface_create_for_data(
+                data + static_cast<size_t>(y) * stride + static_cast<size_t>(x) * 4, CAIRO_FORMAT_ARGB32, w, h, stride);
+            bytes = encode_and_write(job_, rect, filename, line_number_, stage_, files_);
+            cairo_surface_destroy(rect);
+        }
+        files_.back().delta = !last_file_.empty();
+        files_.back().x = x;
+        files_.back().y = y;
+        if (bytes == 0) {
+            last_file_.clear();
+            return 0;
+        }
+        prev.resize(static_cast<size_t>(stride) * height);
+        for (int row = y; row < y + h; ++row) {
+            const size_t offset = static_cast<size_t>(row) * stride + static_cast<size_t>(x) * 4;
+            std::memcpy(prev.data() + offset, data + offset, static_cast<size_t>(w) * 4);
+        }
+        last_file_ = filename;
+        return bytes;
+    }
+
+private:
+    const RenderJob& job_;
+    int line_number_;
+    TigStageScope& stage_;
+    std::vector<RenderedFile>& files_;
+    bool last_ok_ = false;
+    std::string last_file_;  // --delta: last frame written, empty = next frame whole
+};
+
+// -DTIG_GLYPH_CACHE_FILL draws text without an outline with
+// cairo_show_glyphs(), compositing cached glyph masks instead of building
+// and filling a path. That moves edge pixels, so it stays off until the
+// golden references confirm the result.
+#ifdef TIG_GLYPH_CACHE_FILL
+constexpr bool kGlyphCacheFill = true;
+#else
+constexpr bool kGlyphCacheFill = false;
+#endif
+
+// One instantiation per style combination, so the per-line code carries no
+// style branches:
+//  Outline: stroke the glyph outlines before filling them; otherwise only
+//           the fill is drawn (from the glyph cache with TIG_GLYPH_CACHE_FILL).
+//  PaintBg: fill the surface with the background color; otherwise it stays
+//           as created (cleared to transparent).
+template <bool Outline, bool PaintBg>
+size_t render_line(const RenderJob& job, const std::string& text, int line_number,
+                   std::vector<RenderedFile>& files) {
+    const TextOptions& opts = *job.opts;
+    TIG_PROBE2(line__start, line_number, text.size());
+    TigStageScope stage(TIG_STAGE_LAYOUT);
+
+    static thread_local TextLayout layout;
+    if (!layout_text(job, text, layout)) {
+        std::cerr << "Could not lay out line " << line_number << std::endl;
+        TIG_PROBE2(line__end, line_number, 0);
+        return 0;
+    }
+
+    double full_width, full_height;
+    place_layout(opts, opts.outline_width, layout, full_width, full_height);
+    const int num_glyphs = static_cast<int>(layout.glyphs.size());
+
+    // Every scale draws the same glyph run in 1x user space under cairo_scale()
+    size_t written = 0;
+    for (const OutputScale& out : job.outputs) {
+        stage.next(TIG_STAGE_RASTER);
+        cairo_surface_t* surface = tig_surface_create(CAIRO_FORMAT_ARGB32,
+                                                      static_cast<int>(ceil(full_width * out.factor)),
+                                                      static_cast<int>(ceil(full_height * out.factor)));
+        cairo_t* cr = cairo_create(surface);
+
+        if (PaintBg) {
+            cairo_set_source_rgba(cr, opts.bg_r, opts.bg_g, opts.bg_b, opts.bg_a);
+            cairo_paint(cr);  // Fill entire surface with background color
+        }
+        cairo_scale(cr, out.factor, out.factor);
+        cairo_set_scaled_font(cr, out.font);
+        cairo_set_antialias(cr, job.antialias);
+
+        if (!Outline && kGlyphCacheFill) {
+            cairo_set_source_rgb(cr, opts.text_r, opts.text_g, opts.text_b);
+            cairo_show_glyphs(cr, layout.glyphs.data(), num_glyphs);
+        } else {
+            cairo_glyph_path(cr, layout.glyphs.data(), num_glyphs);
+            if (Outline) {
+                cairo_set_source_rgb(cr, opts.outline_r, opts.outline_g, opts.outline_b);
+                cairo_set_line_width(cr, opts.outline_width);
+                cairo_stroke_preserve(cr);  // Stroke the outline and preserve the path for fill
+            }
+            cairo_set_source_rgb(cr, opts.text_r, opts.text_g, opts.text_b);
+            cairo_fill(cr);
+        }
+
+        cairo_surface_flush(surface);
+        TIG_PROBE2(rasterize, line_number,
+                   static_cast<size_t>(cairo_image_surface_get_stride(surface)) * cairo_image_surface_get_height(surface));
+
+        written += encode_and_write(job, surface, output_filename(opts, line_number, out.suffix), line_number, stage,
+                                    files);
+
+        cairo_destroy(cr);
+        cairo_surface_destroy(surface);
+    }
+    TIG_PROBE2(line__end, line_number, written);
+    return written;
+}
+
+// Rasterizes one coverage plane of a laid-out line into a new width x height
+// A8 surface: the stroke for stroke_width > 0, otherwise the fill (from
+// cached glyph masks when glyph_cache, else as a path).
+static cairo_surface_t* rasterize_mask(const RenderJob& job, const TextLayout& layout, const OutputScale& out,
+                                       int width, int height, int stroke_width, bool glyph_cache = false) {
+    cairo_surface_t* mask = tig_surface_create(CAIRO_FORMAT_A8, width, height);
+    cairo_t* cr = cairo_create(mask);
+    cairo_scale(cr, out.factor, out.factor);
+    cairo_set_scaled_font(cr, out.font);
+    const int num_glyphs = static_cast<int>(layout.glyphs.size());
+    if (glyph_cache && stroke_width <= 0) {
+        cairo_show_glyphs(cr, layout.glyphs.data(), num_glyphs);
+    } else {
+        cairo_set_antialias(cr, job.antialias);
+        cairo_glyph_path(cr, layout.glyphs.data(), num_glyphs);
+        if (stroke_width > 0) {
+            cairo_set_line_width(cr, stroke_width);
+            cairo_stroke(cr);
+        } else {
+            cairo_fill(cr);
+        }
+    }
+    cairo_destroy(cr);
+    cairo_surface_flush(mask);
+    return mask;
+}
+
+static inline uint8_t color_byte(double v) {
+    return static_cast<uint8_t>(lround(std::min(1.0, std::max(0.0, v)) * 255));
+}
+
+static void set_effect_layer(TigEffectLayer& layer, cairo_surface_t* mask, double r, double g, double b) {
+    layer.plane = mask ? cairo_image_surface_get_data(mask) : nullptr;
+    layer.stride = mask ? cairo_image_surface_get_stride(mask) : 0;
+    layer.r = color_byte(r);
+    layer.g = color_byte(g);
+    layer.b = color_byte(b);
+    layer.a = 255;
+}
+
+// The effect graph of one style over its fill and stroke masks (stroke may
+// be null). --gradient spans the line's ink box at this scale.
+static void style_graph(const TextOptions& style, const TextLayout& layout, double factor, cairo_surface_t* fill,
+                        cairo_surface_t* stroke, TigEffectGraph& graph) {
+    set_effect_layer(graph.background, nullptr, style.bg_r, style.bg_g, style.bg_b);
+    graph.background.a = color_byte(style.bg_a);
+    set_effect_layer(graph.outline, stroke, style.outline_r, style.outline_g, style.outline_b);
+    set_effect_layer(graph.fill, fill, style.text_r, style.text_g, style.text_b);
+    if (style.gradient && !layout.glyphs.empty()) {
+        set_effect_layer(graph.gradient_end, nullptr, style.gradient_r, style.gradient_g, style.gradient_b);
+        graph.gradient_y0 = (layout.glyphs[0].y + layout.extents.y_bearing) * factor;
+        graph.gradient_y1 = graph.gradient_y0 + layout.extents.height * factor;
+    }
+}
+
+// --variant jobs. Per line and scale the glyph coverage is rasterized once
+// into A8 masks: the fill, plus one stroke mask per distinct outline width.
+// Each variant is then one tig_effects_render() pass over those masks in its
+// own colors. All variants of a line share one canvas, sized for the widest
+// outline, so they can be swapped in a preview without shifting.
+size_t render_line_variants(const RenderJob& job, const std::string& text, int line_number,
+                            std::vector<RenderedFile>& files) {
+    const TextOptions& opts = *job.opts;
+    TIG_PROBE2(line__start, line_number, text.size());
+    TigStageScope stage(TIG_STAGE_LAYOUT);
+
+    static thread_local TextLayout layout;
+    if (!layout_text(job, text, layout)) {
+        std::cerr << "Could not lay out line " << line_number << std::endl;
+        TIG_PROBE2(line__end, line_number, 0);
+        return 0;
+    }
+    double full_width, full_height;
+    place_layout(opts, job.max_outline_width, layout, full_width, full_height);
+
+    size_t written = 0;
+    for (const OutputScale& out : job.outputs) {
+        stage.next(TIG_STAGE_RASTER);
+        const int width = static_cast<int>(ceil(full_width * out.factor));
+        const int height = static_cast<int>(ceil(full_height * out.factor));
+
+        cairo_surface_t* fill_mask =
+            rasterize_mask(job, layout, out, width, height, 0, kGlyphCacheFill && job.max_outline_width == 0);
+        std::vector<std::pair<int, cairo_surface_t*>> stroke_masks;  // by outline width
+        for (const TextOptions& v : opts.variants) {
+            if (v.outline_width <= 0) continue;
+            bool have = false;
+            for (const auto& m : stroke_masks) have = have || m.first == v.outline_width;
+            if (have) continue;
+            stroke_masks.emplace_back(v.outline_width,
+                                      rasterize_mask(job, layout, out, width, height, v.outline_width));
+        }
+
+        for (const TextOptions& v : opts.variants) {
+            stage.next(TIG_STAGE_RASTER);
+            cairo_surface_t* stroke = nullptr;
+            for (const auto& m : stroke_masks) {
+                if (m.first == v.outline_width) stroke = m.second;
+            }
+            TigEffectGraph graph;
+            style_graph(v, layout, out.factor, fill_mask, stroke, graph);
+            graph.linear = opts.linear_blend;
+            cairo_surface_t* surface = tig_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+            tig_effects_render(graph, cairo_image_surface_get_data(surface), width, height,
+                               cairo_image_surface_get_stride(surface));
+            cairo_surface_mark_dirty(surface);
+            TIG_PROBE2(rasterize, line_number,
+                       static_cast<size_t>(cairo_image_surface_get_stride(surface)) * height);
+            written += encode_and_write(job, surface,
+                                        output_filename(opts, line_number, "-" + v.variant_name + out.suffix),
+                                        line_number, stage, files);
+            cairo_surface_destroy(surface);
+        }
+
+        for (const auto& m : stroke_masks) cairo_surface_destroy(m.second);
+        cairo_surface_destroy(fill_mask);
+    }
+    TIG_PROBE2(line__end, line_number, written);
+    return written;
+}
+
+// Draws a laid-out line in style onto a new width x height surface (karaoke,
+// animation and burn-in layers, and lines with --shadow/--glow/--gradient or
+// --linear-blend).
+// With effects the fill and stroke are rasterized as A8 masks, shadow and
+// glow blurred from their combined coverage (one plane if the radii match),
+// and tig_effects_render() composites background, shadow, glow, outline and
+// fill per tile, writing each pixel once.
+static cairo_surface_t* draw_layer(const RenderJob& job, const TextOptions& style, const TextLayout& layout,
+                                   const OutputScale& out, int width, int height) {
+    const TextOptions& opts = *job.opts;
+    cairo_surface_t* surface = tig_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+    if (opts.shadow.enabled || opts.glow.enabled || style.gradient || opts.linear_blend) {
+        const bool outline = style.outline_width > 0;
+        cairo_surface_t* fill = rasterize_mask(job, layout, out, width, height, 0, kGlyphCacheFill && !outline);
+        cairo_surface_t* stroke = outline ? rasterize_mask(job, layout, out, width, height, style.outline_width)
+                                          : nullptr;
+        TigEffectGraph graph;
+        style_graph(style, layout, out.factor, fill, stroke, graph);
+        graph.linear = opts.linear_blend;
+
+        static thread_local std::vector<uint8_t> shadow_plane, glow_plane;
+        if (opts.shadow.enabled || opts.glow.enabled) {
+            // Blur input: the alpha of the text drawn over its outline
+            static thread_local std::vector<uint8_t> coverage;
+            coverage.resize(static_cast<size_t>(width) * height);
+            for (int y = 0; y < height; ++y) {
+                const uint8_t* f = graph.fill.plane + static_cast<size_t>(y) * graph.fill.stride;
+                const uint8_t* s = outline ? graph.outline.plane + static_cast<size_t>(y) * graph.outline.stride : f;
+                uint8_t* c = coverage.data() + static_cast<size_t>(y) * width;
+                for (int x = 0; x < width; ++x) c[x] = static_cast<uint8_t>(f[x] + tig_div255(s[x] * (255u - f[x])));
+            }
+            const double shadow_radius = opts.shadow.radius * out.factor, glow_radius = opts.glow.radius * out.factor;
+            if (opts.shadow.enabled) {
+                shadow_plane = coverage;
+                tig_blur_plane(shadow_plane, width, height, shadow_radius);
+                graph.shadow = {shadow_plane.data(), width, opts.shadow.r, opts.shadow.g, opts.shadow.b, opts.shadow.a};
+                graph.shadow_dx = static_cast<int>(lround(opts.shadow.dx * out.factor));
+                graph.shadow_dy = static_cast<int>(lround(opts.shadow.dy * out.factor));
+            }
+            if (opts.glow.enabled) {
+                const bool shared = opts.shadow.enabled && glow_radius == shadow_radius;
+                if (!shared) {
+                    glow_plane = coverage;
+                    tig_blur_plane(glow_plane, width, height, glow_radius);
+                }
+                graph.glow = {shared ? shadow_plane.data() : glow_plane.data(), width, opts.glow.r, opts.glow.g,
+                              opts.glow.b, opts.glow.a};
+            }
+        }
+        tig_effects_render(graph, cairo_image_surface_get_data(surface), width, height,
+                           cairo_image_surface_get_stride(surface));
+        cairo_surface_mark_dirty(surface);
+        if (stroke) cairo_surface_destroy(stroke);
+        cairo_surface_destroy(fill);
+        return surface;
+    }
+
+    cairo_t* cr = cairo_create(surface);
+    if (style.bg_a > 0.0) {
+        cairo_set_source_rgba(cr, style.bg_r, style.bg_g, style.bg_b, style.bg_a);
+        cairo_paint(cr);
+    }
+    cairo_scale(cr, out.factor, out.factor);
+    cairo_set_scaled_font(cr, out.font);
+    cairo_set_antialias(cr, job.antialias);
+    const int num_glyphs = static_cast<int>(layout.glyphs.size());
+    if (style.outline_width <= 0 && kGlyphCacheFill) {
+        cairo_set_source_rgb(cr, style.text_r, style.text_g, style.text_b);
+        cairo_show_glyphs(cr, layout.glyphs.data(), num_glyphs);
+    } else {
+        cairo_glyph_path(cr, layout.glyphs.data(), num_glyphs);
+        if (style.outline_width > 0) {
+            cairo_set_source_rgb(cr, style.outline_r, style.outline_g, style.outline_b);
+            cairo_set_line_width(cr, style.outline_width);
+            cairo_stroke_preserve(cr);
+        }
+        cairo_set_source_rgb(cr, style.text_r, style.text_g, style.text_b);
+        cairo_fill(cr);
+    }
+    cairo_destroy(cr);
+    cairo_surface_flush(surface);
+    return surface;
+}
+
+// Lines with --shadow/--glow/--gradient/--linear-blend (no karaoke or
+// animation): the text layer with its effects is the image.
+size_t render_line_effects(const RenderJob& job, const std::string& text, int line_number,
+                           std::vector<RenderedFile>& files) {
+    const TextOptions& opts = *job.opts;
+    TIG_PROBE2(line__start, line_number, text.size());
+    TigStageScope stage(TIG_STAGE_LAYOUT);
+
+    static thread_local TextLayout layout;
+    if (!layout_text(job, text, layout)) {
+        std::cerr << "Could not lay out line " << line_number << std::endl;
+        TIG_PROBE2(line__end, line_number, 0);
+        return 0;
+    }
+    double full_width, full_height;
+    place_layout(opts, opts.outline_width, layout, full_width, full_height, job.effect_margin);
+
+    size_t written = 0;
+    for (const OutputScale& out : job.outputs) {
+        stage.next(TIG_STAGE_RASTER);
+        cairo_surface_t* surface = draw_layer(job, opts, layout, out, static_cast<int>(ceil(full_width * out.factor)),
+                                              static_cast<int>(ceil(full_height * out.factor)));
+        TIG_PROBE2(rasterize, line_number,
+                   static_cast<size_t>(cairo_image_surface_get_stride(surface)) * cairo_image_surface_get_height(surface));
+        written += encode_and_write(job, surface, output_filename(opts, line_number, out.suffix), line_number, stage,
+                                    files);
+        cairo_surface_destroy(surface);
+    }
+    TIG_PROBE2(line__end, line_number, written);
+    return written;
+}
+
+// --karaoke. Per output the line is rasterized twice, in the base and the
+// highlight style. Each frame at t = start + n / fps is then a row-wise copy:
+// highlight left of the x where the first unlit glyph cluster starts, base
+// right of it (a left-to-right sweep, so RTL runs light up mirrored).
+// Frames whose boundary did not move reuse the previous PNG.
+// Output: <prefix><N>-<frame, 5 digits><scale suffix>.png
+size_t render_line_karaoke(const RenderJob& job, const std::string& text, int line_number,
+                           std::vector<RenderedFile>& files) {
+    const TextOptions& opts = *job.opts;
+    TIG_PROBE2(line__start, line_number, text.size());
+    TigStageScope stage(TIG_STAGE_LAYOUT);
+
+    static thread_local TigKaraokeLine karaoke;
+    static thread_local TextLayout layout;
+    if (!tig_karaoke_parse(text, karaoke)) {
+        std::cerr << "Line " << line_number << " has no karaoke timing, skipped" << std::endl;
+        TIG_PROBE2(line__end, line_number, 0);
+        return 0;
+    }
+    if (!layout_text(job, karaoke.text, layout, true)) {
+        std::cerr << "Could not lay out line " << line_number << std::endl;
+        TIG_PROBE2(line__end, line_number, 0);
+        return 0;
+    }
+    double full_width, full_height;
+    place_layout(opts, opts.outline_width, layout, full_width, full_height, job.effect_margin);
+
+    // First byte and pen x (1x) of every cluster
+    static thread_local std::vector<size_t> cluster_bytes;
+    static thread_local std::vector<double> cluster_x;
+    cluster_bytes.clear();
+    cluster_x.clear();
+    size_t byte = 0, glyph = 0;
+    for (const cairo_text_cluster_t& c : layout.clusters) {
+        if (c.num_glyphs > 0 && glyph < layout.glyphs.size()) {
+            cluster_bytes.push_back(byte);
+            cluster_x.push_back(layout.glyphs[glyph].x);
+        }
+        byte += static_cast<size_t>(c.num_bytes);
+        glyph += static_cast<size_t>(c.num_glyphs);
+    }
+
+    const int64_t duration_ms = karaoke.end_ms - karaoke.start_ms;
+    const int frames = static_cast<int>(std::max<int64_t>(0, duration_ms) * opts.fps / 1000) + 1;
+    size_t written = 0;
+    for (const OutputScale& out : job.outputs) {
+        stage.next(TIG_STAGE_RASTER);
+        const int width = static_cast<int>(ceil(full_width * out.factor));
+        const int height = static_cast<int>(ceil(full_height * out.factor));
+        cairo_surface_t* base = draw_layer(job, opts, layout, out, width, height);
+        cairo_surface_t* lit = draw_layer(job, job.highlight, layout, out, width, height);
+        cairo_surface_t* frame = tig_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+        cairo_surface_flush(frame);
+        const int stride = cairo_image_surface_get_stride(frame);
+        const unsigned char* base_data = cairo_image_surface_get_data(base);
+        const unsigned char* lit_data = cairo_image_surface_get_data(lit);
+        unsigned char* frame_data = cairo_image_surface_get_data(frame);
+        TIG_PROBE2(rasterize, line_number, static_cast<size_t>(stride) * height * 2);
+
+        FrameWriter writer(job, line_number, stage, files);
+        int prev_clip = -1;
+        for (int n = 0; n < frames; ++n) {
+            const int64_t t = karaoke.start_ms + static_cast<int64_t>(n) * 1000 / opts.fps;
+            const size_t lit_bytes = tig_karaoke_highlight_bytes(karaoke, t, cluster_bytes);
+            double x = full_width;
+            for (size_t i = 0; i < cluster_bytes.size(); ++i) {
+                if (cluster_bytes[i] >= lit_bytes) {
+                    x = cluster_x[i];
+                    break;
+                }
+            }
+            const int clip = lit_bytes == 0 ? 0 : std::min(width, std::max(0, static_cast<int>(lround(x * out.factor))));
+            const bool same = clip == prev_clip;
+            if (!same) {
+                stage.next(TIG_STAGE_RASTER);
+                for (int y = 0; y < height; ++y) {
+                    const size_t row = static_cast<size_t>(y) * stride;
+                    std::memcpy(frame_data + row, lit_data + row, static_cast<size_t>(clip) * 4);
+                    std::memcpy(frame_data + row + clip * 4, base_data + row + clip * 4,
+                                static_cast<size_t>(width - clip) * 4);
+                }
+                cairo_surface_mark_dirty(frame);
+            }
+            char suffix[16];
+            std::snprintf(suffix, sizeof(suffix), "-%05d", n);
+            written += writer.write(frame, output_filename(opts, line_number, suffix + out.suffix), same);
+            prev_clip = clip;
+        }
+
+        cairo_surface_destroy(frame);
+        cairo_surface_destroy(lit);
+        cairo_surface_destroy(base);
+    }
+    TIG_PROBE2(line__end, line_number, written);
+    return written;
+}
+
+// Halves src with a box-like filter (one level of the pop mip chain).
+static cairo_surface_t* downsample_half(cairo_surface_t* src) {
+    const int w = cairo_image_surface_get_width(src), h = cairo_image_surface_get_height(src);
+    const int hw = std::max(1, (w + 1) / 2), hh = std::max(1, (h + 1) / 2);
+    cairo_surface_t* dst = tig_surface_create(CAIRO_FORMAT_ARGB32, hw, hh);
+    cairo_t* cr = cairo_create(dst);
+    cairo_scale(cr, static_cast<double>(hw) / w, static_cast<double>(hh) / h);
+    cairo_set_source_surface(cr, src, 0, 0);
+    cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_GOOD);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+    cairo_surface_flush(dst);
+    return dst;
+}
+
+// --animate. Per output the line is rasterized once into a premultiplied
+// layer; frames only fade, move or scale that layer:
+//  - opacity: the scale_argb32 kernel (premultiplied, so all channels alike)
+//  - slides: integer translation as clipped row copies, fused with the fade
+//  - pop: bilinear draw from the mip level just above the frame scale (the
+//    chain is built on first use), then the fade
+// A frame equal to the previous one is not recomposed or re-encoded.
+// Output (--anim-format): png <prefix><N>-<frame>.png, apng <prefix><N>.png
+// (repeated frames merged into longer delays; with --delta later frames are
+// only their changed rectangle), raw <prefix><N>.rgba
+// (straight-alpha RGBA frames back to back, for ffmpeg -f rawvideo).
+size_t render_line_animated(const RenderJob& job, const std::string& text, int line_number,
+                            std::vector<RenderedFile>& files) {
+    const TextOptions& opts = *job.opts;
+    const TigKernels& kernels = tig_kernels();
+    TIG_PROBE2(line__start, line_number, text.size());
+    TigStageScope stage(TIG_STAGE_LAYOUT);
+
+    static thread_local TextLayout layout;
+    if (!layout_text(job, text, layout)) {
+        std::cerr << "Could not lay out line " << line_number << std::endl;
+        TIG_PROBE2(line__end, line_number, 0);
+        return 0;
+    }
+    double full_width, full_height;
+    place_layout(opts, opts.outline_width, layout, full_width, full_height, job.effect_margin);
+
+    static thread_local std::vector<TigApngFrame> apng_frames;
+    static thread_local std::vector<unsigned char> apng_prev;
+    static thread_local std::vector<unsigned char> stream;
+    size_t written = 0;
+    for (const OutputScale& out : job.outputs) {
+        stage.next(TIG_STAGE_RASTER);
+        const int width = static_cast<int>(ceil(full_width * out.factor));
+        const int height = static_cast<int>(ceil(full_height * out.factor));
+        std::vector<cairo_surface_t*> mips{draw_layer(job, opts, layout, out, width, height)};
+        cairo_surface_t* frame = tig_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+        cairo_surface_flush(frame);
+        const int stride = cairo_image_surface_get_stride(frame);
+        const size_t frame_bytes = static_cast<size_t>(stride) * height;
+        const unsigned char* layer_data = cairo_image_surface_get_data(mips[0]);
+        unsigned char* frame_data = cairo_image_surface_get_data(frame);
+        TIG_PROBE2(rasterize, line_number, frame_bytes);
+
+        FrameWriter writer(job, line_number, stage, files);
+        size_t apng_count = 0;
+        bool encode_failed = false;  // an APNG frame did not encode; the line stops
+        stream.clear();
+        bool have_prev = false;
+        uint32_t prev_alpha = 0;
+        int prev_x = 0, prev_y = 0;
+        double prev_scale = 0.0;
+        for (int n = 0; n < opts.anim.frames; ++n) {
+            const TigFrameState st = tig_anim_frame(opts.anim, n);
+            const uint32_t alpha = static_cast<uint32_t>(lround(st.opacity * 256));
+            const int ix = static_cast<int>(lround(st.dx * width));
+            const int iy = static_cast<int>(lround(st.dy * height));
+            const bool same = have_prev && alpha == prev_alpha && ix == prev_x && iy == prev_y && st.scale == prev_scale;
+            if (!same) {
+                stage.next(TIG_STAGE_RASTER);
+                std::memset(frame_data, 0, frame_bytes);
+                if (alpha > 0 && st.scale == 1.0) {
+                    const int x0 = std::max(0, ix), x1 = std::min(width, width + ix);
+                    for (int y = std::max(0, iy); y < std::min(height, height + iy) && x1 > x0; ++y) {
+                        kernels.scale_argb32(
+                            reinterpret_cast<const uint32_t*>(layer_data + static_cast<size_t>(y - iy) * stride) + (x0 - ix),
+                            reinterpret_cast<uint32_t*>(frame_data + static_cast<size_t>(y) * stride) + x0,
+                            static_cast<size_t>(x1 - x0), alpha);
+                    }
+                } else if (alpha > 0 && st.scale > 0.0) {
+                    size_t level = 0;
+                    while (std::ldexp(1.0, -static_cast<int>(level + 1)) >= st.scale) {
+                        if (level + 1 == mips.size()) {
+                            if (cairo_image_surface_get_width(mips.back()) <= 1 &&
+                                cairo_image_surface_get_height(mips.back()) <= 1) break;
+                            mips.push_back(downsample_half(mips.back()));
+                        }
+                        ++level;
+                    }
+                    cairo_surface_t* mip = mips[level];
+                    const int mw = cairo_image_surface_get_width(mip), mh = cairo_image_surface_get_height(mip);
+                    cairo_t* cr = cairo_create(frame);
+                    cairo_translate(cr, width / 2.0 + ix, height / 2.0 + iy);
+                    cairo_scale(cr, st.scale * width / mw, st.scale * height / mh);
+                    cairo_set_source_surface(cr, mip, -mw / 2.0, -mh / 2.0);
+                    cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_BILINEAR);
+                    cairo_paint(cr);
+                    cairo_destroy(cr);
+                    cairo_surface_flush(frame);
+                    if (alpha < 256) {
+                        for (int y = 0; y < height; ++y) {
+                            uint32_t* row = reinterpret_cast<uint32_t*>(frame_data + static_cast<size_t>(y) * stride);
+                            kernels.scale_argb32(row, row, static_cast<size_t>(width), alpha);
+                        }
+                    }
+                }
+                cairo_surface_mark_dirty(frame);
+            }
+            have_prev = true;
+            prev_alpha = alpha;
+            prev_x = ix;
+            prev_y = iy;
+            prev_scale = st.scale;
+
+            if (opts.anim_format == "png") {
+                char suffix[16];
+                std::snprintf(suffix, sizeof(suffix), "-%05d", n);
+                written += writer.write(frame, output_filename(opts, line_number, suffix + out.suffix), same);
+            } else if (opts.anim_format == "apng") {
+                int x = 0, y = 0, w = width, h = height;
+                const bool changed = !same && (!opts.delta || apng_count == 0 ||
+                                               dirty_rect(apng_prev.data(), frame_data, width, height, stride, x, y, w, h));
+                if (!changed && apng_frames[apng_count - 1].delay < 0xFFFF) {
+                    apng_frames[apng_count - 1].delay++;
+                    continue;
+                }
+                stage.next(TIG_STAGE_ENCODE);
+                if (apng_frames.size() <= apng_count) apng_frames.resize(apng_count + 1);
+                TigApngFrame& f = apng_frames[apng_count++];
+                f.png.clear();
+                f.x = static_cast<uint32_t>(x);
+                f.y = static_cast<uint32_t>(y);
+                f.delay = 1;
+                bool encoded;
+                if (w == width && h == height) {
+                    encoded = tig_png_encode(frame, f.png, job.png_compression);
+                } else {
+                    cairo_surface_t* rect = cairo_image_surface_create_for_data(
+                        frame_data + static_cast<size_t>(y) * stride + static_cast<size_t>(x) * 4, CAIRO_FORMAT_ARGB32,
+                        w, h, stride);
+                    encoded = tig_png_encode(rect, f.png, job.png_compression);
+                    cairo_surface_destroy(rect);
+                }
+                TIG_PROBE2(encode, line_number, f.png.size());
+                // A failed encode can leave a truncated stream behind a valid signature
+                if (!encoded) {
+                    encode_failed = true;
+                    break;
+                }
+                if (opts.delta) apng_prev.assign(frame_data, frame_data + frame_bytes);
+            } else {
+                stage.next(TIG_STAGE_ENCODE);
+                const size_t size = static_cast<size_t>(width) * 4;
+                const size_t start = stream.size();
+                stream.resize(start + size * height);
+                if (same) {
+                    std::memcpy(stream.data() + start, stream.data() + start - size * height, size * height);
+                    continue;
+                }
+                for (int y = 0; y < height; ++y) {
+                    kernels.argb32_to_rgba(reinterpret_cast<const uint32_t*>(frame_data + static_cast<size_t>(y) * stride),
+                                           stream.data() + start + size * y, static_cast<size_t>(width));
+                }
+            }
+        }
+
+        if (opts.anim_format == "apng") {
+            apng_frames.resize(apng_count);
+            const std::string filename = output_filename(opts, line_number, out.suffix);
+            stage.next(TIG_STAGE_ENCODE);
+            static thread_local std::vector<unsigned char> apng;
+            if (encode_failed) {
+                std::cerr << "Error encoding PNG frame: " << filename << std::endl;
+                files.push_back({filename, width, height, 0});
+            } else if (tig_apng_assemble(apng_frames, static_cast<uint16_t>(opts.fps), 1, apng)) {
+                written += write_output(filename, apng, width, height, line_number, stage, files);
+            } else {
+                std::cerr << "Error encoding APNG: " << filename << std::endl;
+                files.push_back({filename, width, height, 0});
+            }
+        } else if (opts.anim_format == "raw") {
+            written += write_output(opts.output_prefix + std::to_string(line_number) + out.suffix + ".rgba", stream,
+                                    width, height, line_number, stage, files);
+        }
+
+        cairo_surface_destroy(frame);
+        for (cairo_surface_t* mip : mips) cairo_surface_destroy(mip);
+        if (encode_failed) break;
+    }
+    TIG_PROBE2(line__end, line_number, written);
+    return written;
+}
+
+// Resolves the font (FontConfig -> FreeType -> cairo scaled font) and picks
+// the render path. Returns false, after reporting, if the font is unusable.
+bool open_render_job(RenderJob& job, const TextOptions& opts) {
+    TigStageScope stage(TIG_STAGE_FONT);
+    job.opts = &opts;
+
+    // One FreeType library per process; faces are released through cairo.
+    static FT_Library ft_library = nullptr;
+    if (!ft_library && FT_Init_FreeType(&ft_library)) {
         std::cerr << "Could not init FreeType" << std::endl;
-        return;
+        return false;
     }
 
     // Find font file using FontConfig
@@ -106,143 +1206,403 @@ void render_text_to_png(const std::string& text, const std::string& filename, co
     FcPattern* pattern = FcNameParse((const FcChar8*)opts.font_name.c_str());
     FcConfigSubstitute(config, pattern, FcMatchPattern);
     FcDefaultSubstitute(pattern);
-    
+
     FcResult result;
     FcPattern* font = FcFontMatch(config, pattern, &result);
-    
-    char* font_file = nullptr;
+
+    std::string font_file;
     if (font) {
         FcChar8* file_utf8;
         if (FcPatternGetString(font, FC_FILE, 0, &file_utf8) == FcResultMatch) {
             font_file = (char*)file_utf8;
         }
     }
-    
-    if (!font_file) {
+    FcPatternDestroy(pattern);
+    if (font) FcPatternDestroy(font);
+    FcConfigDestroy(config);
+
+    TIG_PROBE2(font__resolve, 0, font_file.empty() ? nullptr : font_file.c_str());
+    if (font_file.empty()) {
         std::cerr << "Could not find font: " << opts.font_name << std::endl;
-        FcPatternDestroy(pattern);
-        FcPatternDestroy(font);
-        FcConfigDestroy(config);
-        FT_Done_FreeType(ft_library);
-        return;
+        return false;
     }
-    
+
+    job.font_file = font_file;
+
     // Create font face
     FT_Face ft_face;
-    if (FT_New_Face(ft_library, font_file, 0, &ft_face)) {
+    if (FT_New_Face(ft_library, font_file.c_str(), 0, &ft_face)) {
         std::cerr << "Could not load font file: " << font_file << std::endl;
-        FcPatternDestroy(pattern);
-        FcPatternDestroy(font);
-        FcConfigDestroy(config);
-        FT_Done_FreeType(ft_library);
-        return;
+        return false;
     }
-    
-    // Set font size
-    FT_Set_Pixel_Sizes(ft_face, 0, opts.font_size);
-    
-    // Initialize Cairo with FreeType
-    cairo_surface_t* ft_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
-    cairo_t* ft_cr = cairo_create(ft_surface);
-    cairo_font_face_t* cairo_ft_face = cairo_ft_font_face_create_for_ft_face(ft_face, 0);
-    cairo_set_font_face(ft_cr, cairo_ft_face);
-    cairo_font_options_t* font_opts = cairo_font_options_create();
-    cairo_font_options_set_antialias(font_opts, CAIRO_ANTIALIAS_DEFAULT);
-    cairo_set_font_options(ft_cr, font_opts);
-    cairo_set_font_size(ft_cr, opts.font_size);
-    
-    // Measure text size
-    cairo_text_extents_t extents;
-    cairo_text_extents(ft_cr, text.c_str(), &extents);
-    
-    // Calculate image dimensions properly
-    // extents.width and extents.height may not include the full character bounds
-    // extents.x_advance and y_advance include the advance width
-    // For outline text, account for the outline width too
-    double text_width = extents.width;
-    double text_height = extents.height;
-    
-    // Calculate proper bounding box including bearing (offsets from origin)
-    double bearing_x = extents.x_bearing;
-    double bearing_y = extents.y_bearing;
-    
-    // Determine the full dimensions needed
-    double full_width = std::abs(bearing_x) + text_width + opts.padding * 2 + opts.outline_width * 2;
-    double full_height = std::abs(bearing_y) + text_height + opts.padding * 2 + opts.outline_width * 2;
-    
-    // Ensure minimum dimensions (in case of very short text)
-    if (full_width < opts.font_size * 1.5) // Just a reasonable minimum
-        full_width = opts.font_size * 1.5;
-    if (full_height < opts.font_size)
-        full_height = opts.font_size * 1.2;
-    
-    // Create the actual surface for the image
-    cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 
-                                                         static_cast<int>(ceil(full_width)), 
-                                                         static_cast<int>(ceil(full_height)));
-    cairo_t* cr = cairo_create(surface);
-    
-    // Draw background if not transparent
-    if (opts.bg_a > 0.0) {
-        cairo_set_source_rgba(cr, opts.bg_r, opts.bg_g, opts.bg_b, opts.bg_a);
-        cairo_paint(cr);  // Fill entire surface with background color
+
+    static cairo_user_data_key_t ft_face_key;
+    job.font_face = cairo_ft_font_face_create_for_ft_face(ft_face, 0);
+    if (cairo_font_face_set_user_data(job.font_face, &ft_face_key, ft_face, release_ft_face) != CAIRO_STATUS_SUCCESS) {
+        FT_Done_Face(ft_face);
+        std::cerr << "Could not create font face: " << font_file << std::endl;
+        return false;
+    }
+
+    // Start from the image surface's font options and merge ours on top, as
+    // cairo does when it creates the scaled font for a context itself.
+    // Proxies trade quality for speed: fast antialiasing, no hinting and a
+    // cheap zlib level unless one was given.
+    if (opts.proxy > 0) {
+        job.antialias = CAIRO_ANTIALIAS_FAST;
+        job.png_compression = opts.png_compression >= 0 ? opts.png_compression : 1;
     } else {
-        // If background is transparent, clear to transparent
-        cairo_set_source_rgba(cr, 0, 0, 0, 0);
-        cairo_paint(cr);
+        job.png_compression = opts.png_compression;
     }
-    
-    // Set font and size
-    cairo_set_font_face(cr, cairo_ft_face);
-    cairo_set_font_size(cr, opts.font_size);
-    cairo_set_font_options(cr, font_opts);
-    
-    // Draw outline and text - proper approach
-    // Position the text with proper alignment in the center of the image
-    double x_pos = opts.padding + opts.outline_width * 2 - bearing_x;  // Adjust for possible large outline
-    double y_pos = opts.padding + opts.outline_width * 2 - bearing_y + opts.font_size;  // Adjust for font baseline
-    
-    // Move to the correct position
-    cairo_move_to(cr, x_pos, y_pos);
-    
-    // Create the text path
-    cairo_text_path(cr, text.c_str());
-    
-    // If outline width > 0, stroke with outline color first
-    if (opts.outline_width > 0) {
-        cairo_set_source_rgb(cr, opts.outline_r, opts.outline_g, opts.outline_b);
-        cairo_set_line_width(cr, opts.outline_width);
-        cairo_stroke_preserve(cr);  // Stroke the outline and preserve the path for fill
+    job.font_opts = cairo_font_options_create();
+    cairo_font_options_t* user_opts = cairo_font_options_create();
+    cairo_font_options_set_antialias(user_opts, job.antialias);
+    if (opts.proxy > 0) cairo_font_options_set_hint_style(user_opts, CAIRO_HINT_STYLE_NONE);
+    cairo_surface_t* probe_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
+    cairo_surface_get_font_options(probe_surface, job.font_opts);
+    cairo_font_options_merge(job.font_opts, user_opts);
+    cairo_surface_destroy(probe_surface);
+    cairo_font_options_destroy(user_opts);
+    cairo_matrix_t font_matrix, ctm;
+    cairo_matrix_init_scale(&font_matrix, opts.font_size, opts.font_size);
+    cairo_matrix_init_identity(&ctm);
+    job.scaled_font = cairo_scaled_font_create(job.font_face, &font_matrix, &ctm, job.font_opts);
+    if (cairo_scaled_font_status(job.scaled_font) != CAIRO_STATUS_SUCCESS) {
+        std::cerr << "Could not create scaled font: " << font_file << std::endl;
+        return false;
     }
-    
-    // Fill the text with text color
-    cairo_set_source_rgb(cr, opts.text_r, opts.text_g, opts.text_b);
-    cairo_fill(cr);
-    
-    // Write to PNG
-    cairo_status_t status = cairo_surface_write_to_png(surface, filename.c_str());
-    if (status != CAIRO_STATUS_SUCCESS) {
-        std::cerr << "Error writing PNG: " << cairo_status_to_string(status) << std::endl;
+
+    // A proxy renders every output at 1/N of its size, under the same name.
+    const double proxy_factor = opts.proxy > 0 ? 1.0 / opts.proxy : 1.0;
+    std::vector<std::pair<std::string, std::string>> sizes;  // scale, suffix
+    if (opts.scales.empty()) sizes.emplace_back("1", "");
+    for (const std::string& scale : opts.scales) sizes.emplace_back(scale, "@" + scale);
+    for (const auto& size : sizes) {
+        OutputScale out;
+        out.factor = std::stod(size.first) * proxy_factor;
+        out.suffix = size.second;
+        if (out.factor == 1.0) {
+            out.font = cairo_scaled_font_reference(job.scaled_font);
+        } else {
+            cairo_matrix_init_scale(&ctm, out.factor, out.factor);
+            out.font = cairo_scaled_font_create(job.font_face, &font_matrix, &ctm, job.font_opts);
+        }
+        job.outputs.push_back(out);
+        if (cairo_scaled_font_status(out.font) != CAIRO_STATUS_SUCCESS) {
+            std::cerr << "Could not create scaled font for scale " << size.first << std::endl;
+            return false;
+        }
     }
-    
-    // Cleanup
-    cairo_destroy(cr);
-    cairo_surface_destroy(surface);
-    cairo_font_options_destroy(font_opts);
-    cairo_destroy(ft_cr);
-    cairo_surface_destroy(ft_surface);
-    cairo_font_face_destroy(cairo_ft_face);
-    FT_Done_Face(ft_face);
-    FT_Done_FreeType(ft_library);
-    FcPatternDestroy(pattern);
-    FcPatternDestroy(font);
-    FcConfigDestroy(config);
+
+    // Room for the blur and the shadow offset at every output scale, in 1x pixels
+    for (const OutputScale& out : job.outputs) {
+        if (opts.glow.enabled) {
+            job.effect_margin = std::max(job.effect_margin, tig_blur_reach(opts.glow.radius * out.factor) / out.factor);
+        }
+        if (opts.shadow.enabled) {
+            job.effect_margin = std::max(job.effect_margin,
+                                         tig_blur_reach(opts.shadow.radius * out.factor) / out.factor +
+                                             std::max(std::fabs(opts.shadow.dx), std::fabs(opts.shadow.dy)));
+        }
+    }
+    job.effect_margin = ceil(job.effect_margin);
+
+    if (!opts.burn_in.empty()) {
+        job.path_name = "burn-in onto " + (opts.burn_in == "-" ? std::string("raw RGBA stream") : opts.burn_in) +
+                        " at " + std::to_string(opts.fps) + " fps";
+        return true;  // main runs burn_in() instead of the line loop
+    }
+
+    if (opts.anim.effects) {
+        job.render = render_line_animated;
+        job.path_name = "animation, " + std::to_string(opts.anim.frames) + " frames as " + opts.anim_format;
+        if (opts.proxy > 0) job.path_name += ", proxy 1/" + std::to_string(opts.proxy);
+        return true;
+    }
+
+    if (opts.karaoke) {
+        job.highlight = opts;
+        job.highlight.variants.clear();
+        job.highlight.text_r = opts.hl_r;
+        job.highlight.text_g = opts.hl_g;
+        job.highlight.text_b = opts.hl_b;
+        if (opts.hl_outline_set) {
+            job.highlight.outline_r = opts.hl_outline_r;
+            job.highlight.outline_g = opts.hl_outline_g;
+            job.highlight.outline_b = opts.hl_outline_b;
+        }
+        job.render = render_line_karaoke;
+        job.path_name = "karaoke frames at " + std::to_string(opts.fps) + " fps";
+        if (opts.proxy > 0) job.path_name += ", proxy 1/" + std::to_string(opts.proxy);
+        return true;  // frame count varies per line, so no fixed suffixes
+    }
+
+    if (!opts.variants.empty()) {
+        for (const TextOptions& v : opts.variants) {
+            job.max_outline_width = std::max(job.max_outline_width, v.outline_width);
+            for (const OutputScale& out : job.outputs) job.suffixes.push_back("-" + v.variant_name + out.suffix);
+        }
+        job.render = render_line_variants;
+        job.path_name = std::to_string(opts.variants.size()) + " variants from shared glyph coverage";
+        if (opts.linear_blend) job.path_name += ", linear light";
+        if (opts.proxy > 0) job.path_name += ", proxy 1/" + std::to_string(opts.proxy);
+        return true;
+    }
+
+    if (opts.shadow.enabled || opts.glow.enabled || opts.gradient || opts.linear_blend) {
+        job.render = render_line_effects;
+        std::string effects;
+        for (const char* name : {opts.shadow.enabled ? "shadow" : "", opts.glow.enabled ? "glow" : "",
+                                 opts.gradient ? "gradient" : ""}) {
+            if (*name) effects += (effects.empty() ? "" : "+") + std::string(name);
+        }
+        job.path_name = (effects.empty() ? std::string("fill+outline") : effects) +
+                        ", fused effect pass over coverage masks";
+        if (opts.linear_blend) job.path_name += ", linear light";
+        if (opts.proxy > 0) job.path_name += ", proxy 1/" + std::to_string(opts.proxy);
+        for (const OutputScale& out : job.outputs) job.suffixes.push_back(out.suffix);
+        return true;
+    }
+
+    static const RenderFn paths[2][2] = {
+        {render_line<false, false>, render_line<false, true>},
+        {render_line<true, false>, render_line<true, true>},
+    };
+    const bool outline = opts.outline_width > 0;
+    const bool paint_bg = opts.bg_a > 0.0;
+    job.render = paths[outline][paint_bg];
+    job.path_name = std::string(outline ? "fill+outline" : kGlyphCacheFill ? "fill (glyph cache)" : "fill") + ", " +
+                    (paint_bg ? "painted" : "transparent") + " background";
+    if (opts.proxy > 0) job.path_name += ", proxy 1/" + std::to_string(opts.proxy);
+    for (const OutputScale& out : job.outputs) job.suffixes.push_back(out.suffix);
+    return true;
+}
+
+// --burn-in: every input line is a timed cue (the forms in tig_karaoke.h,
+// e.g. an ASS Dialogue line), composited onto existing video frames. A cue is
+// rasterized once, when the first frame it covers comes up, and blended onto
+// each of its frames with the over_argb32 kernel; its layer is dropped after
+// its last frame. Frame n shows time n / fps. Cues showing at the same time
+// stack away from --burn-position in input order.
+struct BurnCue {
+    int line_number = 0;
+    int64_t start_ms = 0, end_ms = 0;
+    std::string text;
+    cairo_surface_t* layer = nullptr;  // while the cue is showing
+};
+
+class BurnTrack {
+public:
+    BurnTrack(const RenderJob& job, std::vector<BurnCue> cues) : job_(job), cues_(std::move(cues)) {
+        std::stable_sort(cues_.begin(), cues_.end(),
+                         [](const BurnCue& a, const BurnCue& b) { return a.start_ms < b.start_ms; });
+    }
+    ~BurnTrack() {
+        for (BurnCue& cue : cues_) {
+            if (cue.layer) cairo_surface_destroy(cue.layer);
+        }
+    }
+    BurnTrack(const BurnTrack&) = delete;
+    BurnTrack& operator=(const BurnTrack&) = delete;
+
+    size_t cues_rendered() const { return rendered_; }
+
+    // Blends the cues showing at t_ms onto an ARGB32 frame.
+    void composite(int64_t t_ms, unsigned char* data, int width, int height, int stride) {
+        while (next_ < cues_.size() && cues_[next_].start_ms <= t_ms) {
+            BurnCue& cue = cues_[next_++];
+            if (cue.end_ms > t_ms && rasterize(cue)) active_.push_back(&cue);
+        }
+        for (size_t i = 0; i < active_.size();) {
+            if (active_[i]->end_ms <= t_ms) {
+                cairo_surface_destroy(active_[i]->layer);
+                active_[i]->layer = nullptr;
+                active_.erase(active_.begin() + static_cast<std::ptrdiff_t>(i));
+            } else {
+                ++i;
+            }
+        }
+        std::sort(active_.begin(), active_.end(),
+                  [](const BurnCue* a, const BurnCue* b) { return a->line_number < b->line_number; });
+
+        const TigKernels& kernels = tig_kernels();
+        const std::string& position = job_.opts->burn_position;
+        int offset = 0;  // height taken by the cues already placed
+        for (const BurnCue* cue : active_) {
+            const int lw = cairo_image_surface_get_width(cue->layer);
+            const int lh = cairo_image_surface_get_height(cue->layer);
+            const int lstride = cairo_image_surface_get_stride(cue->layer);
+            const unsigned char* ldata = cairo_image_surface_get_data(cue->layer);
+            const int x = (width - lw) / 2;
+            int y = height - offset - lh;
+            if (position == "top") y = offset;
+            else if (position == "center") y = (height - lh) / 2 + offset;
+            offset += lh;
+            const int x0 = std::max(0, x), x1 = std::min(width, x + lw);
+            for (int row = std::max(0, y); row < std::min(height, y + lh) && x1 > x0; ++row) {
+                kernels.over_argb32(reinterpret_cast<const uint32_t*>(ldata + static_cast<size_t>(row - y) * lstride) +
+                                        (x0 - x),
+                                    reinterpret_cast<uint32_t*>(data + static_cast<size_t>(row) * stride) + x0,
+                                    static_cast<size_t>(x1 - x0));
+            }
+        }
+    }
+
+private:
+    bool rasterize(BurnCue& cue) {
+        static thread_local TextLayout layout;
+        TIG_PROBE2(line__start, cue.line_number, cue.text.size());
+        TigStageScope stage(TIG_STAGE_LAYOUT);
+        if (!layout_text(job_, cue.text, layout)) {
+            std::cerr << "Could not lay out line " << cue.line_number << std::endl;
+            TIG_PROBE2(line__end, cue.line_number, 0);
+            return false;
+        }
+        double full_width, full_height;
+        place_layout(*job_.opts, job_.opts->outline_width, layout, full_width, full_height, job_.effect_margin);
+        stage.next(TIG_STAGE_RASTER);
+        cue.layer = draw_layer(job_, *job_.opts, layout, job_.outputs[0], static_cast<int>(ceil(full_width)),
+                               static_cast<int>(ceil(full_height)));
+        TIG_PROBE2(line__end, cue.line_number, 0);
+        ++rendered_;
+        return true;
+    }
+
+    const RenderJob& job_;
+    std::vector<BurnCue> cues_;  // by start time
+    size_t next_ = 0;            // first cue not yet started
+    std::vector<BurnCue*> active_;
+    size_t rendered_ = 0;
+};
+
+static bool read_exact(FILE* in, unsigned char* buffer, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        const size_t n = std::fread(buffer + done, 1, size - done, in);
+        if (n == 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+// Frames come from a directory of PNGs (sorted by name, each written to
+// <prefix><name>) or, for "-", raw RGBA of --frame-size on stdin, written as
+// raw RGBA to <prefix> ("-" = stdout). Returns the exit status.
+static int burn_in(const RenderJob& job, std::istream& input) {
+    const TextOptions& opts = *job.opts;
+    auto start_time = std::chrono::steady_clock::now();
+
+    std::vector<BurnCue> cues;
+    TigKaraokeLine timing;
+    std::string line;
+    for (int line_number = 1; std::getline(input, line); ++line_number) {
+        if (line.empty()) continue;
+        if (!tig_karaoke_parse(line, timing)) {
+            std::cerr << "Line " << line_number << " has no cue timing, skipped" << std::endl;
+            continue;
+        }
+        BurnCue cue;
+        cue.line_number = line_number;
+        cue.start_ms = timing.start_ms;
+        cue.end_ms = timing.end_ms;
+        cue.text = timing.text;
+        cues.push_back(cue);
+    }
+    const size_t cue_count = cues.size();
+    BurnTrack track(job, std::move(cues));
+
+    uint64_t frames = 0, bytes_written = 0;
+    if (opts.burn_in == "-") {
+        const int width = opts.frame_width, height = opts.frame_height;
+        const bool to_stdout = opts.output_prefix == "-";
+        FILE* out = to_stdout ? stdout : std::fopen(opts.output_prefix.c_str(), "wb");
+        if (!out) {
+            std::cerr << "Could not open output file: " << opts.output_prefix << std::endl;
+            return 1;
+        }
+        cairo_surface_t* frame = tig_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+        cairo_surface_flush(frame);
+        const int stride = cairo_image_surface_get_stride(frame);
+        unsigned char* data = cairo_image_surface_get_data(frame);
+        const size_t row_bytes = static_cast<size_t>(width) * 4;
+        std::vector<unsigned char> rgba(row_bytes * height);
+        const TigKernels& kernels = tig_kernels();
+        bool ok = true;
+        while (ok && read_exact(stdin, rgba.data(), rgba.size())) {
+            for (int y = 0; y < height; ++y) {
+                tig_rgba_to_argb32(rgba.data() + row_bytes * y,
+                                   reinterpret_cast<uint32_t*>(data + static_cast<size_t>(y) * stride),
+                                   static_cast<size_t>(width));
+            }
+            track.composite(static_cast<int64_t>(frames) * 1000 / opts.fps, data, width, height, stride);
+            for (int y = 0; y < height; ++y) {
+                kernels.argb32_to_rgba(reinterpret_cast<const uint32_t*>(data + static_cast<size_t>(y) * stride),
+                                       rgba.data() + row_bytes * y, static_cast<size_t>(width));
+            }
+            ok = std::fwrite(rgba.data(), 1, rgba.size(), out) == rgba.size();
+            bytes_written += ok ? rgba.size() : 0;
+            ++frames;
+        }
+        cairo_surface_destroy(frame);
+        ok = (to_stdout ? std::fflush(out) : std::fclose(out)) == 0 && ok;
+        if (!ok) {
+            std::cerr << "Error writing frames to " << (to_stdout ? "stdout" : opts.output_prefix) << std::endl;
+            return 1;
+        }
+    } else {
+        std::vector<std::string> names;
+        if (DIR* dir = opendir(opts.burn_in.c_str())) {
+            while (dirent* entry = readdir(dir)) {
+                const std::string name = entry->d_name;
+                if (name.size() > 4 && name.compare(name.size() - 4, 4, ".png") == 0) names.push_back(name);
+            }
+            closedir(dir);
+        } else {
+            std::cerr << "Could not open frame directory: " << opts.burn_in << std::endl;
+            return 1;
+        }
+        std::sort(names.begin(), names.end());
+        for (const std::string& name : names) {
+            const std::string path = opts.burn_in + "/" + name;
+            cairo_surface_t* frame = tig_png_decode(path.c_str());
+            if (!frame) {
+                std::cerr << "Could not read frame: " << path << std::endl;
+                return 1;
+            }
+            track.composite(static_cast<int64_t>(frames) * 1000 / opts.fps, cairo_image_surface_get_data(frame),
+                            cairo_image_surface_get_width(frame), cairo_image_surface_get_height(frame),
+                            cairo_image_surface_get_stride(frame));
+            static thread_local std::vector<unsigned char> png;
+            png.clear();
+            const std::string filename = opts.output_prefix + name;
+            const bool ok = tig_png_encode(frame, png, opts.png_compression) && write_file(filename, png);
+            cairo_surface_destroy(frame);
+            if (!ok) {
+                std::cerr << "Error writing frame: " << filename << std::endl;
+                return 1;
+            }
+            bytes_written += png.size();
+            ++frames;
+            if (!opts.quiet) std::cout << "Created: " << filename << std::endl;
+        }
+    }
+
+    if (opts.verbose) {
+        std::cerr << "Burned " << track.cues_rendered() << " of " << cue_count << " cues into " << frames
+                  << " frames" << std::endl;
+    }
+    if (opts.stats) {
+        double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        tig_print_stats(stderr, track.cues_rendered(), frames, bytes_written, wall_s);
+    }
+    return 0;
 }
 
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         std::cerr << "Usage: " << argv[0] << " <input_file> <output_prefix> [options]" << std::endl;
         std::cerr << "   or: " << argv[0] << " --list-fonts" << std::endl;
+        std::cerr << "   or: " << argv[0] << " --merge-manifests OUT PART..." << std::endl;
         std::cerr << "Options:" << std::endl;
         std::cerr << "  --font-name FONT       Font name (default: DejaVu Sans)" << std::endl;
         std::cerr << "  --font-size SIZE       Font size (default: 48)" << std::endl;
@@ -251,7 +1611,54 @@ int main(int argc, char* argv[]) {
         std::cerr << "  --outline-width WIDTH  Outline width (default: 2)" << std::endl;
         std::cerr << "  --bg-color COLOR       Background color (default: transparent, #00000000)" << std::endl;
         std::cerr << "  --padding PADDING      Padding around text (default: 20)" << std::endl;
+        std::cerr << "  --scales LIST          Also render at these scales, e.g. 1,1.5,2,4 -> <prefix><N>@<scale>.png" << std::endl;
+        std::cerr << "  --variant NAME         Start a style variant; following color/outline options apply to it," << std::endl;
+        std::cerr << "                         output <prefix><N>-<NAME>.png (repeatable)" << std::endl;
+        std::cerr << "  --proxy N              Quick preview: 1/N size, fast antialiasing and PNG compression" << std::endl;
+        std::cerr << "  --finalize             Re-render only the proxy outputs in the manifest at full quality" << std::endl;
+        std::cerr << "  --png-compression N    zlib level 0-9 (default: libpng default; 1 with --proxy)" << std::endl;
+        std::cerr << "  --manifest FILE        Record written files as JSON Lines" << std::endl;
+        std::cerr << "                         (default with --proxy/--finalize: <prefix>manifest.jsonl)" << std::endl;
+        std::cerr << "  --shard I/N            Render only shard I of N of the lines, keeping global numbering;" << std::endl;
+        std::cerr << "                         writes <prefix>manifest-shard-IofN.jsonl" << std::endl;
+        std::cerr << "  --shard-mode MODE      round-robin (default) or contiguous blocks" << std::endl;
+        std::cerr << "  --queue DIR            Take chunks of lines from a claim queue in DIR shared by any number" << std::endl;
+        std::cerr << "                         of workers; the last one merges <prefix>manifest.jsonl" << std::endl;
+        std::cerr << "  --queue-chunk N        Lines per queue chunk, fixed by the first worker (default: 32)" << std::endl;
+        std::cerr << "  --queue-lease SECONDS  Take over claims not renewed for this long (default: 300)" << std::endl;
+        std::cerr << "  --checkpoint           Journal finished lines to <prefix>checkpoint.jsonl; SIGINT/SIGTERM" << std::endl;
+        std::cerr << "                         stop after the current line" << std::endl;
+        std::cerr << "  --resume               Continue a checkpointed run: skip lines whose outputs are intact" << std::endl;
+        std::cerr << "                         (refused if the render options changed)" << std::endl;
+        std::cerr << "  --jobs N|auto          Render N lines at once (default: 1); auto starts at the CPUs the" << std::endl;
+        std::cerr << "                         cgroup quota allows and adapts to throughput and memory.max" << std::endl;
+        std::cerr << "  --schedule ORDER       --jobs order: longest-first (estimated cost, default) or input" << std::endl;
+        std::cerr << "  --karaoke              Lines carry LRC <mm:ss.xx> or ASS {\\k} timing; write highlight" << std::endl;
+        std::cerr << "                         frames <prefix><N>-<frame>.png" << std::endl;
+        std::cerr << "  --fps N                Frame rate of karaoke, APNG and burn-in frames (default: 25)" << std::endl;
+        std::cerr << "  --highlight-color COLOR          Karaoke highlight text color (default: #FFFF00)" << std::endl;
+        std::cerr << "  --highlight-outline-color COLOR  Karaoke highlight outline color (default: outline color)" << std::endl;
+        std::cerr << "  --animate LIST         Animate each line: fade-in,fade-out,fade,slide-left|right|up|down,pop" << std::endl;
+        std::cerr << "  --frames N             Animation frames per line (default: 25)" << std::endl;
+        std::cerr << "  --easing NAME          linear|ease-in|ease-out|ease-in-out|back (default: ease-out)" << std::endl;
+        std::cerr << "  --anim-format FORMAT   png (<prefix><N>-<frame>.png), apng (<prefix><N>.png)" << std::endl;
+        std::cerr << "                         or raw (<prefix><N>.rgba) (default: png)" << std::endl;
+        std::cerr << "  --delta                Frame sequences: write only the rectangle that changed since the" << std::endl;
+        std::cerr << "                         previous frame, skip unchanged frames (offsets in the manifest)" << std::endl;
+        std::cerr << "  --burn-in SRC          Composite timed cues onto video frames: SRC is a directory of PNGs" << std::endl;
+        std::cerr << "                         (written to <prefix><name>) or - for raw RGBA on stdin (written to" << std::endl;
+        std::cerr << "                         <prefix>, - = stdout); frames are --fps apart" << std::endl;
+        std::cerr << "  --frame-size WxH       Raw burn-in frame size" << std::endl;
+        std::cerr << "  --burn-position POS    top|center|bottom (default: bottom)" << std::endl;
+        std::cerr << "  --shadow DX,DY,RADIUS,COLOR  Blurred drop shadow, e.g. 4,4,6,#000000B0" << std::endl;
+        std::cerr << "  --glow RADIUS,COLOR          Blurred glow around the text, e.g. 12,#FFD700" << std::endl;
+        std::cerr << "  --gradient COLOR       Fade the text fill down to COLOR across the ink (per variant)" << std::endl;
+        std::cerr << "  --linear-blend         Blend antialiased edges and effects in linear light, not sRGB" << std::endl;
         std::cerr << "  -v, --verbose          Enable verbose output" << std::endl;
+        std::cerr << "  --stats                Print timing and memory summary at exit" << std::endl;
+        std::cerr << "  --progress             Show progress (lines/s, ETA, bytes) on stderr" << std::endl;
+        std::cerr << "  -q, --quiet            Do not log every created file" << std::endl;
+        std::cerr << "  --simd LEVEL           Pixel kernels: auto|scalar|sse4|avx2|avx512 (default: auto)" << std::endl;
         return 1;
     }
     
@@ -260,10 +1667,25 @@ int main(int argc, char* argv[]) {
         list_fonts();
         return 0;
     }
+
+    // Combine the partial manifests of a --shard run
+    if (std::string(argv[1]) == "--merge-manifests") {
+        if (argc < 4) {
+            std::cerr << "Usage: " << argv[0] << " --merge-manifests OUT PART..." << std::endl;
+            return 1;
+        }
+        std::string error;
+        if (!tig_manifest_merge(std::vector<std::string>(argv + 3, argv + argc), argv[2], error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        return 0;
+    }
     
     if (argc < 3) {
         std::cerr << "Usage: " << argv[0] << " <input_file> <output_prefix> [options]" << std::endl;
         std::cerr << "   or: " << argv[0] << " --list-fonts" << std::endl;
+        std::cerr << "   or: " << argv[0] << " --merge-manifests OUT PART..." << std::endl;
         std::cerr << "Options:" << std::endl;
         std::cerr << "  --font-name FONT       Font name (default: DejaVu Sans)" << std::endl;
         std::cerr << "  --font-size SIZE       Font size (default: 48)" << std::endl;
@@ -272,7 +1694,54 @@ int main(int argc, char* argv[]) {
         std::cerr << "  --outline-width WIDTH  Outline width (default: 2)" << std::endl;
         std::cerr << "  --bg-color COLOR       Background color (default: transparent, #00000000)" << std::endl;
         std::cerr << "  --padding PADDING      Padding around text (default: 20)" << std::endl;
+        std::cerr << "  --scales LIST          Also render at these scales, e.g. 1,1.5,2,4 -> <prefix><N>@<scale>.png" << std::endl;
+        std::cerr << "  --variant NAME         Start a style variant; following color/outline options apply to it," << std::endl;
+        std::cerr << "                         output <prefix><N>-<NAME>.png (repeatable)" << std::endl;
+        std::cerr << "  --proxy N              Quick preview: 1/N size, fast antialiasing and PNG compression" << std::endl;
+        std::cerr << "  --finalize             Re-render only the proxy outputs in the manifest at full quality" << std::endl;
+        std::cerr << "  --png-compression N    zlib level 0-9 (default: libpng default; 1 with --proxy)" << std::endl;
+        std::cerr << "  --manifest FILE        Record written files as JSON Lines" << std::endl;
+        std::cerr << "                         (default with --proxy/--finalize: <prefix>manifest.jsonl)" << std::endl;
+        std::cerr << "  --shard I/N            Render only shard I of N of the lines, keeping global numbering;" << std::endl;
+        std::cerr << "                         writes <prefix>manifest-shard-IofN.jsonl" << std::endl;
+        std::cerr << "  --shard-mode MODE      round-robin (default) or contiguous blocks" << std::endl;
+        std::cerr << "  --queue DIR            Take chunks of lines from a claim queue in DIR shared by any number" << std::endl;
+        std::cerr << "                         of workers; the last one merges <prefix>manifest.jsonl" << std::endl;
+        std::cerr << "  --queue-chunk N        Lines per queue chunk, fixed by the first worker (default: 32)" << std::endl;
+        std::cerr << "  --queue-lease SECONDS  Take over claims not renewed for this long (default: 300)" << std::endl;
+        std::cerr << "  --checkpoint           Journal finished lines to <prefix>checkpoint.jsonl; SIGINT/SIGTERM" << std::endl;
+        std::cerr << "                         stop after the current line" << std::endl;
+        std::cerr << "  --resume               Continue a checkpointed run: skip lines whose outputs are intact" << std::endl;
+        std::cerr << "                         (refused if the render options changed)" << std::endl;
+        std::cerr << "  --jobs N|auto          Render N lines at once (default: 1); auto starts at the CPUs the" << std::endl;
+        std::cerr << "                         cgroup quota allows and adapts to throughput and memory.max" << std::endl;
+        std::cerr << "  --schedule ORDER       --jobs order: longest-first (estimated cost, default) or input" << std::endl;
+        std::cerr << "  --karaoke              Lines carry LRC <mm:ss.xx> or ASS {\\k} timing; write highlight" << std::endl;
+        std::cerr << "                         frames <prefix><N>-<frame>.png" << std::endl;
+        std::cerr << "  --fps N                Frame rate of karaoke, APNG and burn-in frames (default: 25)" << std::endl;
+        std::cerr << "  --highlight-color COLOR          Karaoke highlight text color (default: #FFFF00)" << std::endl;
+        std::cerr << "  --highlight-outline-color COLOR  Karaoke highlight outline color (default: outline color)" << std::endl;
+        std::cerr << "  --animate LIST         Animate each line: fade-in,fade-out,fade,slide-left|right|up|down,pop" << std::endl;
+        std::cerr << "  --frames N             Animation frames per line (default: 25)" << std::endl;
+        std::cerr << "  --easing NAME          linear|ease-in|ease-out|ease-in-out|back (default: ease-out)" << std::endl;
+        std::cerr << "  --anim-format FORMAT   png (<prefix><N>-<frame>.png), apng (<prefix><N>.png)" << std::endl;
+        std::cerr << "                         or raw (<prefix><N>.rgba) (default: png)" << std::endl;
+        std::cerr << "  --delta                Frame sequences: write only the rectangle that changed since the" << std::endl;
+        std::cerr << "                         previous frame, skip unchanged frames (offsets in the manifest)" << std::endl;
+        std::cerr << "  --burn-in SRC          Composite timed cues onto video frames: SRC is a directory of PNGs" << std::endl;
+        std::cerr << "                         (written to <prefix><name>) or - for raw RGBA on stdin (written to" << std::endl;
+        std::cerr << "                         <prefix>, - = stdout); frames are --fps apart" << std::endl;
+        std::cerr << "  --frame-size WxH       Raw burn-in frame size" << std::endl;
+        std::cerr << "  --burn-position POS    top|center|bottom (default: bottom)" << std::endl;
+        std::cerr << "  --shadow DX,DY,RADIUS,COLOR  Blurred drop shadow, e.g. 4,4,6,#000000B0" << std::endl;
+        std::cerr << "  --glow RADIUS,COLOR          Blurred glow around the text, e.g. 12,#FFD700" << std::endl;
+        std::cerr << "  --gradient COLOR       Fade the text fill down to COLOR across the ink (per variant)" << std::endl;
+        std::cerr << "  --linear-blend         Blend antialiased edges and effects in linear light, not sRGB" << std::endl;
         std::cerr << "  -v, --verbose          Enable verbose output" << std::endl;
+        std::cerr << "  --stats                Print timing and memory summary at exit" << std::endl;
+        std::cerr << "  --progress             Show progress (lines/s, ETA, bytes) on stderr" << std::endl;
+        std::cerr << "  -q, --quiet            Do not log every created file" << std::endl;
+        std::cerr << "  --simd LEVEL           Pixel kernels: auto|scalar|sse4|avx2|avx512 (default: auto)" << std::endl;
         return 1;
     }
     
@@ -282,10 +1751,32 @@ int main(int argc, char* argv[]) {
     TextOptions opts;
     opts.output_prefix = output_prefix;
     
-    // Parse additional options
+    // Parse additional options. Style options (colors, outline width) after
+    // --variant NAME apply to that variant; everything else is job-wide.
+    TextOptions* style = &opts;
     for (int i = 3; i < argc; i++) {
         std::string opt = argv[i];
-        if (opt == "--font-name" && i + 1 < argc) {
+        if (opt == "--variant" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name.empty() || name.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789._-") != std::string::npos) {
+                std::cerr << "Invalid variant name: '" << name << "' (use letters, digits, '.', '_' or '-')" << std::endl;
+                return 1;
+            }
+            for (const TextOptions& v : opts.variants) {
+                if (v.variant_name == name) {
+                    std::cerr << "Duplicate variant name: " << name << std::endl;
+                    return 1;
+                }
+            }
+            TextOptions variant;
+            variant.variant_name = name;
+            copy_style(opts, variant);  // variants start from the base style
+            opts.variants.push_back(variant);
+            style = &opts.variants.back();
+            if (opts.verbose) {
+                std::cout << "Parsed: variant = " << name << std::endl;
+            }
+        } else if (opt == "--font-name" && i + 1 < argc) {
             opts.font_name = argv[++i];  // Increment i to skip the value
             if (opts.verbose) {
                 std::cout << "Parsed: font-name = " << opts.font_name << std::endl;
@@ -302,9 +1793,9 @@ int main(int argc, char* argv[]) {
                 unsigned int r, g, b;
                 int matched = sscanf(color.c_str(), "%02x%02x%02x", &r, &g, &b);
                 if (matched == 3) {
-                    opts.text_r = r / 255.0;
-                    opts.text_g = g / 255.0;
-                    opts.text_b = b / 255.0;
+                    style->text_r = r / 255.0;
+                    style->text_g = g / 255.0;
+                    style->text_b = b / 255.0;
                     if (opts.verbose) {
                         std::cout << "Parsed: text-color = #" << color << " -> RGB(" << r << "," << g << "," << b << ")" << std::endl;
                     }
@@ -321,9 +1812,9 @@ int main(int argc, char* argv[]) {
                 unsigned int r, g, b;
                 int matched = sscanf(color.c_str(), "%02x%02x%02x", &r, &g, &b);
                 if (matched == 3) {
-                    opts.outline_r = r / 255.0;
-                    opts.outline_g = g / 255.0;
-                    opts.outline_b = b / 255.0;
+                    style->outline_r = r / 255.0;
+                    style->outline_g = g / 255.0;
+                    style->outline_b = b / 255.0;
                     if (opts.verbose) {
                         std::cout << "Parsed: outline-color = #" << color << " -> RGB(" << r << "," << g << "," << b << ")" << std::endl;
                     }
@@ -343,24 +1834,227 @@ int main(int argc, char* argv[]) {
                 } else {  // RGB format
                     sscanf(color.c_str(), "%02x%02x%02x", &r, &g, &b);
                 }
-                opts.bg_r = r / 255.0;
-                opts.bg_g = g / 255.0;
-                opts.bg_b = b / 255.0;
-                opts.bg_a = a / 255.0;
+                style->bg_r = r / 255.0;
+                style->bg_g = g / 255.0;
+                style->bg_b = b / 255.0;
+                style->bg_a = a / 255.0;
                 if (opts.verbose) {
                     std::cout << "Parsed: bg-color = #" << color << " -> RGB(" << r << "," << g << "," << b << "), A=" << a << std::endl;
                 }
             }
         } else if (opt == "--outline-width" && i + 1 < argc) {
-            opts.outline_width = std::stoi(argv[++i]);  // Increment i to skip the value
+            style->outline_width = std::stoi(argv[++i]);  // Increment i to skip the value
             if (opts.verbose) {
-                std::cout << "Parsed: outline-width = " << opts.outline_width << std::endl;
+                std::cout << "Parsed: outline-width = " << style->outline_width << std::endl;
             }
         } else if (opt == "--padding" && i + 1 < argc) {
             opts.padding = std::stoi(argv[++i]);  // Increment i to skip the value
             if (opts.verbose) {
                 std::cout << "Parsed: padding = " << opts.padding << std::endl;
             }
+        } else if (opt == "--scales" && i + 1 < argc) {
+            std::string list = argv[++i];
+            opts.scales.clear();
+            size_t pos = 0;
+            while (pos <= list.size()) {
+                size_t comma = list.find(',', pos);
+                if (comma == std::string::npos) comma = list.size();
+                std::string scale = list.substr(pos, comma - pos);
+                char* end = nullptr;
+                double factor = std::strtod(scale.c_str(), &end);
+                if (scale.empty() || *end != '\0' || !(factor > 0.0) || !std::isfinite(factor)) {
+                    std::cerr << "Invalid --scales entry: '" << scale << "' (expected e.g. 1,1.5,2,4)" << std::endl;
+                    return 1;
+                }
+                opts.scales.push_back(scale);
+                pos = comma + 1;
+            }
+            if (opts.verbose) {
+                std::cout << "Parsed: scales = " << list << std::endl;
+            }
+        } else if (opt == "--proxy" && i + 1 < argc) {
+            std::string value = argv[++i];
+            char* end = nullptr;
+            long n = std::strtol(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0' || n < 1 || n > 64) {
+                std::cerr << "Invalid --proxy factor: '" << value << "' (expected 1-64)" << std::endl;
+                return 1;
+            }
+            opts.proxy = static_cast<int>(n);
+            if (opts.verbose) {
+                std::cout << "Parsed: proxy = " << opts.proxy << std::endl;
+            }
+        } else if (opt == "--karaoke") {
+            opts.karaoke = true;
+        } else if (opt == "--fps" && i + 1 < argc) {
+            std::string value = argv[++i];
+            char* end = nullptr;
+            long fps = std::strtol(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0' || fps < 1 || fps > 240) {
+                std::cerr << "Invalid --fps: '" << value << "' (expected 1-240)" << std::endl;
+                return 1;
+            }
+            opts.fps = static_cast<int>(fps);
+        } else if ((opt == "--highlight-color" || opt == "--highlight-outline-color") && i + 1 < argc) {
+            std::string color = argv[++i];
+            if (color[0] == '#') color = color.substr(1);
+            unsigned int r, g, b;
+            if (color.length() != 6 || sscanf(color.c_str(), "%02x%02x%02x", &r, &g, &b) != 3) {
+                std::cerr << "Warning: Invalid " << opt.substr(2) << " format: " << color << " (expected #RRGGBB)" << std::endl;
+            } else if (opt == "--highlight-color") {
+                opts.hl_r = r / 255.0;
+                opts.hl_g = g / 255.0;
+                opts.hl_b = b / 255.0;
+            } else {
+                opts.hl_outline_r = r / 255.0;
+                opts.hl_outline_g = g / 255.0;
+                opts.hl_outline_b = b / 255.0;
+                opts.hl_outline_set = true;
+            }
+        } else if (opt == "--animate" && i + 1 < argc) {
+            std::string list = argv[++i];
+            if (!tig_anim_parse(list, opts.anim.effects)) {
+                std::cerr << "Invalid --animate list: '" << list
+                          << "' (expected e.g. fade-in,slide-up; effects: fade-in, fade-out, fade, slide-left, "
+                             "slide-right, slide-up, slide-down, pop)" << std::endl;
+                return 1;
+            }
+        } else if (opt == "--frames" && i + 1 < argc) {
+            std::string value = argv[++i];
+            char* end = nullptr;
+            long frames = std::strtol(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0' || frames < 1 || frames > 10000) {
+                std::cerr << "Invalid --frames: '" << value << "' (expected 1-10000)" << std::endl;
+                return 1;
+            }
+            opts.anim.frames = static_cast<int>(frames);
+        } else if (opt == "--easing" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (!tig_easing_parse(name, opts.anim.easing)) {
+                std::cerr << "Unknown --easing: " << name << " (expected linear|ease-in|ease-out|ease-in-out|back)" << std::endl;
+                return 1;
+            }
+        } else if (opt == "--anim-format" && i + 1 < argc) {
+            opts.anim_format = argv[++i];
+            if (opts.anim_format != "png" && opts.anim_format != "apng" && opts.anim_format != "raw") {
+                std::cerr << "Unknown --anim-format: " << opts.anim_format << " (expected png|apng|raw)" << std::endl;
+                return 1;
+            }
+        } else if (opt == "--burn-in" && i + 1 < argc) {
+            opts.burn_in = argv[++i];
+        } else if (opt == "--frame-size" && i + 1 < argc) {
+            std::string value = argv[++i];
+            char* end = nullptr;
+            long w = std::strtol(value.c_str(), &end, 10);
+            long h = *end == 'x' ? std::strtol(end + 1, &end, 10) : 0;
+            if (*end != '\0' || w < 1 || h < 1 || w > 16384 || h > 16384) {
+                std::cerr << "Invalid --frame-size: '" << value << "' (expected WxH)" << std::endl;
+                return 1;
+            }
+            opts.frame_width = static_cast<int>(w);
+            opts.frame_height = static_cast<int>(h);
+        } else if (opt == "--burn-position" && i + 1 < argc) {
+            opts.burn_position = argv[++i];
+            if (opts.burn_position != "top" && opts.burn_position != "center" && opts.burn_position != "bottom") {
+                std::cerr << "Unknown --burn-position: " << opts.burn_position << " (expected top|center|bottom)"
+                          << std::endl;
+                return 1;
+            }
+        } else if ((opt == "--shadow" || opt == "--glow") && i + 1 < argc) {
+            std::string spec = argv[++i];
+            const bool shadow = opt == "--shadow";
+            if (!tig_blur_effect_parse(spec, shadow, shadow ? opts.shadow : opts.glow)) {
+                std::cerr << "Invalid " << opt << ": '" << spec << "' (expected "
+                          << (shadow ? "DX,DY,RADIUS,COLOR" : "RADIUS,COLOR") << ", radius 0-500, color #RRGGBB[AA])"
+                          << std::endl;
+                return 1;
+            }
+        } else if (opt == "--gradient" && i + 1 < argc) {
+            std::string color = argv[++i];
+            if (!color.empty() && color[0] == '#') color = color.substr(1);
+            unsigned int r, g, b;
+            if (color.length() != 6 || sscanf(color.c_str(), "%02x%02x%02x", &r, &g, &b) != 3) {
+                std::cerr << "Invalid --gradient color: '" << argv[i] << "' (expected #RRGGBB)" << std::endl;
+                return 1;
+            }
+            style->gradient = true;
+            style->gradient_r = r / 255.0;
+            style->gradient_g = g / 255.0;
+            style->gradient_b = b / 255.0;
+        } else if (opt == "--linear-blend") {
+            opts.linear_blend = true;
+        } else if (opt == "--delta") {
+            opts.delta = true;
+        } else if (opt == "--finalize") {
+            opts.finalize = true;
+        } else if (opt == "--png-compression" && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (value.size() != 1 || value[0] < '0' || value[0] > '9') {
+                std::cerr << "Invalid --png-compression level: '" << value << "' (expected 0-9)" << std::endl;
+                return 1;
+            }
+            opts.png_compression = value[0] - '0';
+        } else if (opt == "--manifest" && i + 1 < argc) {
+            opts.manifest = argv[++i];
+        } else if (opt == "--shard" && i + 1 < argc) {
+            std::string spec = argv[++i];
+            if (!tig_shard_parse(spec, opts.shard)) {
+                std::cerr << "Invalid --shard: '" << spec << "' (expected I/N with 1 <= I <= N)" << std::endl;
+                return 1;
+            }
+        } else if (opt == "--shard-mode" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (!tig_shard_set_mode(mode, opts.shard)) {
+                std::cerr << "Unknown --shard-mode: " << mode << " (expected round-robin|contiguous)" << std::endl;
+                return 1;
+            }
+        } else if (opt == "--queue" && i + 1 < argc) {
+            opts.queue = argv[++i];
+        } else if ((opt == "--queue-chunk" || opt == "--queue-lease") && i + 1 < argc) {
+            std::string value = argv[++i];
+            char* end = nullptr;
+            long n = std::strtol(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0' || n < 1 || n > 1000000) {
+                std::cerr << "Invalid " << opt << ": '" << value << "' (expected 1-1000000)" << std::endl;
+                return 1;
+            }
+            (opt == "--queue-chunk" ? opts.queue_chunk : opts.queue_lease) = static_cast<int>(n);
+        } else if (opt == "--jobs" && i + 1 < argc) {
+            std::string value = argv[++i];
+            char* end = nullptr;
+            long jobs = std::strtol(value.c_str(), &end, 10);
+            opts.jobs_auto = value == "auto";
+            if (opts.jobs_auto) {
+                // Up to twice the CPU budget; the controller settles in between
+                jobs = std::min(1024u, std::max(2u, 2 * tig_cpu_budget()));
+            } else if (value.empty() || *end != '\0' || jobs < 1 || jobs > 1024) {
+                std::cerr << "Invalid --jobs: '" << value << "' (expected 1-1024 or auto)" << std::endl;
+                return 1;
+            }
+            opts.jobs = static_cast<int>(jobs);
+        } else if (opt == "--schedule" && i + 1 < argc) {
+            std::string order = argv[++i];
+            if (order != "longest-first" && order != "input") {
+                std::cerr << "Unknown --schedule: " << order << " (expected longest-first|input)" << std::endl;
+                return 1;
+            }
+            opts.longest_first = order == "longest-first";
+        } else if (opt == "--checkpoint") {
+            opts.checkpoint = true;
+        } else if (opt == "--resume") {
+            opts.checkpoint = opts.resume = true;
+        } else if (opt == "--stats") {
+            opts.stats = true;
+        } else if (opt == "--progress") {
+            opts.progress = true;
+        } else if ((opt == "--simd" && i + 1 < argc) || opt.compare(0, 7, "--simd=") == 0) {
+            std::string level = opt == "--simd" ? argv[++i] : opt.substr(7);
+            if (!tig_simd_select(level)) {
+                std::cerr << "Unknown --simd level: " << level << " (expected auto|scalar|sse4|avx2|avx512)" << std::endl;
+                return 1;
+            }
+        } else if (opt == "-q" || opt == "--quiet") {
+            opts.quiet = true;
         } else if (opt == "-v" || opt == "--verbose") {
             opts.verbose = true;
             std::cout << "Verbose mode enabled" << std::endl;
@@ -368,6 +2062,75 @@ int main(int argc, char* argv[]) {
         // For options that don't take a parameter (like -v/--verbose), no extra increment is needed
     }
     
+    if (opts.proxy > 0 && opts.finalize) {
+        std::cerr << "--proxy and --finalize cannot be combined" << std::endl;
+        return 1;
+    }
+    if ((opts.karaoke || opts.anim.effects) && !opts.variants.empty()) {
+        std::cerr << (opts.karaoke ? "--karaoke" : "--animate") << " cannot be combined with --variant" << std::endl;
+        return 1;
+    }
+    if (opts.karaoke && opts.anim.effects) {
+        std::cerr << "--karaoke and --animate cannot be combined" << std::endl;
+        return 1;
+    }
+    if ((opts.shadow.enabled || opts.glow.enabled) && !opts.variants.empty()) {
+        std::cerr << (opts.shadow.enabled ? "--shadow" : "--glow") << " cannot be combined with --variant" << std::endl;
+        return 1;
+    }
+    if (!opts.burn_in.empty()) {
+        const char* other = opts.karaoke ? "--karaoke" : opts.anim.effects ? "--animate"
+                          : !opts.variants.empty() ? "--variant" : !opts.scales.empty() ? "--scales"
+                          : opts.proxy > 0 ? "--proxy" : opts.finalize ? "--finalize"
+                          : !opts.manifest.empty() ? "--manifest" : opts.shard.count > 1 ? "--shard"
+                          : !opts.queue.empty() ? "--queue" : opts.checkpoint ? "--checkpoint"
+                          : opts.jobs > 1 ? "--jobs" : nullptr;
+        if (other) {
+            std::cerr << "--burn-in cannot be combined with " << other << std::endl;
+            return 1;
+        }
+        if (opts.burn_in == "-" && opts.frame_width == 0) {
+            std::cerr << "--burn-in - needs --frame-size WxH" << std::endl;
+            return 1;
+        }
+        if (opts.output_prefix == "-" && opts.burn_in != "-") {
+            std::cerr << "Output - (stdout) needs --burn-in -" << std::endl;
+            return 1;
+        }
+        if (opts.output_prefix == "-" && opts.verbose) {
+            std::cerr << "--verbose cannot be combined with output to stdout" << std::endl;
+            return 1;
+        }
+    }
+    if (opts.delta && !opts.karaoke && !opts.anim.effects) {
+        std::cerr << "--delta needs --karaoke or --animate" << std::endl;
+        return 1;
+    }
+    if (opts.delta && opts.anim_format == "raw") {
+        std::cerr << "--delta cannot be combined with --anim-format raw" << std::endl;
+        return 1;
+    }
+    if (!opts.queue.empty() && (opts.shard.count > 1 || opts.finalize || opts.checkpoint)) {
+        std::cerr << "--queue cannot be combined with "
+                  << (opts.finalize ? "--finalize" : opts.checkpoint ? "--checkpoint" : "--shard") << std::endl;
+        return 1;
+    }
+    if (opts.jobs > 1 && !opts.jobs_auto && static_cast<unsigned>(opts.jobs) > tig_cpu_budget()) {
+        std::cerr << "Warning: --jobs " << opts.jobs << " exceeds the " << tig_cpu_budget()
+                  << " CPUs available to this process; --jobs auto respects the limit" << std::endl;
+    }
+    if (opts.checkpoint && opts.finalize) {
+        std::cerr << "--finalize cannot be combined with --checkpoint" << std::endl;
+        return 1;
+    }
+    if (opts.manifest.empty() && opts.shard.count > 1) {
+        opts.manifest = tig_shard_manifest_name(opts.output_prefix, opts.shard);
+    }
+    if (opts.manifest.empty() &&
+        (opts.proxy > 0 || opts.finalize || !opts.queue.empty() || (opts.delta && opts.anim_format == "png"))) {
+        opts.manifest = opts.output_prefix + "manifest.jsonl";
+    }
+
     // Print final configuration in verbose mode
     if (opts.verbose) {
         print_final_config(opts);
@@ -380,17 +2143,277 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    // --finalize: only the lines whose outputs the manifest lists as proxies
+    std::vector<TigManifestEntry> manifest;
+    std::set<int> pending;
+    if (opts.finalize) {
+        if (!tig_manifest_load(opts.manifest, manifest)) {
+            std::cerr << "Could not read manifest: " << opts.manifest << " (render with --proxy first)" << std::endl;
+            return 1;
+        }
+        for (const TigManifestEntry& e : manifest) {
+            if (e.proxy > 0) pending.insert(e.line);
+        }
+        if (opts.verbose) {
+            std::cout << "Finalizing " << pending.size() << " proxy lines" << std::endl;
+        }
+    }
+
+    RenderJob job;
+    if (!open_render_job(job, opts)) {
+        return 1;
+    }
+    if (opts.verbose) {
+        std::cout << "Render path: " << job.path_name << std::endl;
+    }
+    if (!opts.burn_in.empty()) {
+        return burn_in(job, file);
+    }
+
+    // Contiguous shards need the line count up front; so does --progress,
+    // except with --queue, where it counts the lines of the claimed chunks
+    uint64_t total_lines = 0;
+    if (opts.shard.contiguous || (opts.progress && !opts.finalize && opts.queue.empty())) {
+        total_lines = TigProgress::count_lines(input_file, false);
+        tig_shard_plan(opts.shard, total_lines);
+    }
+
+    std::unique_ptr<TigProgress> progress;
+    if (opts.progress) {
+        progress.reset(new TigProgress(opts.finalize ? pending.size() : tig_shard_share(opts.shard, total_lines)));
+        progress->start();
+    }
+
+    std::unique_ptr<TigCheckpoint> journal;
+    if (opts.checkpoint) {
+        const std::string path = tig_checkpoint_name(opts.output_prefix, opts.shard);
+        journal.reset(new TigCheckpoint());
+        std::string error;
+        if (!journal->open(path, opts.resume, render_options_hash(job), error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        tig_install_stop_handlers();
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    uint64_t bytes_written = 0;
+    uint64_t lines_rendered = 0, images_written = 0, lines_resumed = 0;
+    std::atomic<bool> journal_failed(false);
+    std::unique_ptr<TigConcurrency> concurrency;
+    if (opts.jobs_auto) concurrency.reset(new TigConcurrency(tig_cpu_budget(), opts.jobs));
+    std::vector<TigManifestEntry> records;  // this run's outputs
+    std::set<int> finalized;
+    TigQueue* active_queue = nullptr;  // renewed after every line of a claimed chunk
+    std::mutex results_mutex;          // the bookkeeping below, shared by --jobs workers
+    auto render_one = [&](const std::string& line, int line_number) {
+        static thread_local std::vector<RenderedFile> files;
+        uint64_t allocs_before = tig_total_allocs();
+        files.clear();
+        size_t bytes = job.render(job, line, line_number, files);
+        // Allocations of concurrent lines cannot be told apart
+        if (opts.jobs == 1) tig_note_line_allocs(allocs_before);
+        std::lock_guard<std::mutex> lock(results_mutex);
+        if (active_queue) active_queue->renew();
+        bytes_written += bytes;
+        lines_rendered++;
+        bool complete = !files.empty();
+        for (const RenderedFile& f : files) {
+            if (f.bytes > 0) images_written++;
+            else if (f.failed()) complete = false;
+        }
+        if (progress) progress->add(1, bytes);
+        if (!opts.manifest.empty() || journal) {
+            const size_t first = records.size();
+            const uint64_t text_hash = tig_text_hash(line);
+            for (const RenderedFile& f : files) {
+                if (f.failed()) continue;
+                TigManifestEntry e;
+                e.line = line_number;
+                e.file = f.filename;
+                e.text_hash = text_hash;
+                e.width = f.width;
+                e.height = f.height;
+                e.bytes = f.bytes;
+                e.proxy = opts.proxy;
+                e.delta = f.delta;
+                e.x = f.x;
+                e.y = f.y;
+                e.same_as = f.same_as;
+                records.push_back(e);
+            }
+            // A line that failed to render keeps its proxy entries for the next --finalize
+            if (complete) finalized.insert(line_number);
+            // and is not journaled, so --resume renders it again
+            if (journal && complete && !journal_failed &&
+                !journal->record(std::vector<TigManifestEntry>(records.begin() + first, records.end()))) {
+                std::cerr << "Error writing checkpoint" << std::endl;
+                journal_failed = true;
+            }
+        }
+        if (!opts.quiet) {
+            for (const RenderedFile& f : files) {
+                if (f.bytes > 0) std::cout << "Created: " << f.filename << std::endl;
+            }
+        }
+    };
+
+    // Renders (line number, text) pairs on --jobs workers, by default the most
+    // expensive first; records then arrive out of order and are sorted by line.
+    auto render_batch = [&](const std::vector<std::pair<int, std::string>>& batch) {
+        const bool longest_first = opts.longest_first && opts.jobs > 1;
+        std::vector<double> costs(batch.size(), 0.0);
+        if (longest_first || concurrency) {  // the controller measures throughput in estimated cost
+            for (size_t i = 0; i < batch.size(); ++i) costs[i] = estimate_line_cost(job, batch[i].second);
+        }
+        tig_run_scheduled(costs, longest_first, opts.jobs, [&](size_t i) {
+            render_one(batch[i].second, batch[i].first);
+            return !tig_stop_signal() && !journal_failed;
+        }, concurrency.get());
+        std::stable_sort(records.begin(), records.end(),
+                         [](const TigManifestEntry& a, const TigManifestEntry& b) { return a.line < b.line; });
+    };
+
     std::string line;
-    int line_number = 1;
-    while (std::getline(file, line)) {
-        if (!line.empty()) {
-            std::string output_filename = opts.output_prefix + std::to_string(line_number) + ".png";
-            render_text_to_png(line, output_filename, opts);
-            std::cout << "Created: " << output_filename << std::endl;
-            line_number++;
+    if (!opts.queue.empty()) {
+        // Where each non-empty line starts, so a chunk can be read from its first line
+        std::vector<std::streamoff> line_start;
+        std::streamoff offset = 0;
+        while (std::getline(file, line)) {
+            if (!line.empty()) line_start.push_back(offset);
+            offset += static_cast<std::streamoff>(line.size()) + 1;
+        }
+        TigQueue queue;
+        std::string error;
+        if (!queue.open(opts.queue, line_start.size(), opts.queue_chunk, opts.queue_lease, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        uint64_t chunk = 0, chunks_done = 0;
+        std::vector<std::pair<int, std::string>> batch;
+        active_queue = &queue;
+        while (queue.claim(chunk)) {
+            records.clear();
+            batch.clear();
+            file.clear();
+            file.seekg(line_start[queue.first_line(chunk) - 1]);
+            int line_number = static_cast<int>(queue.first_line(chunk));
+            while (batch.size() < queue.chunk_size() && std::getline(file, line)) {
+                if (!line.empty()) batch.emplace_back(line_number++, line);
+            }
+            if (progress) progress->add_total(batch.size());
+            render_batch(batch);
+            // A worker whose lease ran out leaves the chunk to the one that took it over
+            if (queue.owned()) {
+                if (!tig_manifest_save(queue.manifest_path(chunk), records) || !queue.complete()) {
+                    std::cerr << "Error writing to queue directory: " << opts.queue << std::endl;
+                    return 1;
+                }
+            }
+            ++chunks_done;
+        }
+        if (opts.verbose) {
+            std::cout << "Queue: rendered " << chunks_done << " of " << queue.chunks() << " chunks ("
+                      << queue.reclaimed() << " taken over from expired claims)" << std::endl;
+        }
+        // Every chunk is done; one worker joins the chunk manifests
+        records.clear();
+        if (queue.elect("merged")) {
+            for (uint64_t k = 0; k < queue.chunks(); ++k) {
+                if (!tig_manifest_load(queue.manifest_path(k), records)) {
+                    std::cerr << "Could not read manifest: " << queue.manifest_path(k) << std::endl;
+                    return 1;
+                }
+            }
+        } else {
+            if (!opts.manifest.empty()) {
+                std::cout << "Manifest not written: another worker merged the queue (remove " << opts.queue
+                          << "/merged to merge again)" << std::endl;
+            }
+            opts.manifest.clear();
+        }
+        active_queue = nullptr;
+    } else {
+        // With --jobs the lines left to render are collected first, then scheduled
+        std::vector<std::pair<int, std::string>> batch;
+        int line_number = 1;
+        while (std::getline(file, line)) {
+            if (!line.empty()) {
+                if ((opts.finalize && !pending.count(line_number)) || !tig_shard_owns(opts.shard, line_number)) {
+                    line_number++;
+                    continue;
+                }
+                const std::vector<TigManifestEntry>* done = journal ? journal->done(line_number, tig_text_hash(line))
+                                                                    : nullptr;
+                if (done) {
+                    records.insert(records.end(), done->begin(), done->end());
+                    lines_resumed++;
+                    if (progress) progress->add(1, 0);
+                } else if (opts.jobs > 1) {
+                    batch.emplace_back(line_number, line);
+                } else {
+                    render_one(line, line_number);
+                }
+                line_number++;
+                if (tig_stop_signal() || journal_failed) break;
+            }
         }
+        if (!batch.empty()) render_batch(batch);
     }
     
     file.close();
-    return 0;
+    if (progress) progress->stop();
+    if (opts.jobs > 1) {
+        TigWorkerReport& report = tig_worker_report();
+        report.workers = concurrency ? concurrency->target() : static_cast<unsigned>(opts.jobs);
+        if (concurrency) {
+            report.adaptive = true;
+            report.start = concurrency->start();
+            report.lowest = concurrency->lowest();
+            report.highest = concurrency->highest();
+            report.changes = concurrency->changes();
+        }
+    }
+    if (journal) {
+        if (!journal->close()) journal_failed = true;
+        if (opts.resume && !opts.quiet) {
+            std::cout << "Resumed: " << lines_resumed << " lines were already done" << std::endl;
+        }
+        if (tig_stop_signal()) {
+            std::cerr << "Interrupted after " << lines_resumed + lines_rendered
+                      << " lines; run again with --resume to continue" << std::endl;
+        }
+    }
+
+    if (!opts.manifest.empty()) {
+        if (opts.finalize) {
+            // Replace the finalized lines' entries in place, keep everything else
+            std::vector<TigManifestEntry> merged;
+            std::set<int> emitted;
+            for (const TigManifestEntry& e : manifest) {
+                if (!finalized.count(e.line)) {
+                    merged.push_back(e);
+                } else if (emitted.insert(e.line).second) {
+                    for (const TigManifestEntry& r : records) {
+                        if (r.line == e.line) merged.push_back(r);
+                    }
+                }
+            }
+            records.swap(merged);
+        }
+        if (!tig_manifest_save(opts.manifest, records)) {
+            std::cerr << "Error writing manifest: " << opts.manifest << std::endl;
+            return 1;
+        }
+        if (opts.finalize && !opts.quiet) {
+            std::cout << "Finalized " << finalized.size() << " of " << pending.size() << " proxy lines" << std::endl;
+        }
+    }
+
+    if (opts.stats) {
+        double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        tig_print_stats(stderr, lines_rendered, images_written, bytes_written, wall_s);
+    }
+    if (journal_failed) return 1;
+    return tig_stop_signal() ? 128 + tig_stop_signal() : 0;
 }
\ No newline at end of file
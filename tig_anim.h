@@ -0,0 +1,116 @@
+/*
+ * tig_anim.h - Caption animation timeline for text2png --animate
+ *
+ * Effects (combinable, e.g. "fade-in,slide-up"):
+ *   fade-in, fade-out   opacity 0 -> 1 / 1 -> 0; both together fade in over
+ *                       the first half and out over the second
+ *   slide-left|right|up|down
+ *                       enter from one canvas size away, moving in that direction
+ *   pop                 scale 0 -> 1 (overshoots with --easing back)
+ * Each line gets --frames frames; frame n is at progress n / (frames - 1),
+ * shaped by the easing curve.
+ */
+
+#ifndef TIG_ANIM_H
+#define TIG_ANIM_H
+
+#include <algorithm>
+#include <string>
+
+enum TigAnimEffect {
+    TIG_ANIM_FADE_IN = 1 << 0,
+    TIG_ANIM_FADE_OUT = 1 << 1,
+    TIG_ANIM_SLIDE_LEFT = 1 << 2,
+    TIG_ANIM_SLIDE_RIGHT = 1 << 3,
+    TIG_ANIM_SLIDE_UP = 1 << 4,
+    TIG_ANIM_SLIDE_DOWN = 1 << 5,
+    TIG_ANIM_POP = 1 << 6,
+};
+
+enum TigEasing {
+    TIG_EASE_LINEAR,
+    TIG_EASE_IN,      // cubic
+    TIG_EASE_OUT,
+    TIG_EASE_IN_OUT,
+    TIG_EASE_BACK,    // ease-out with ~10% overshoot
+};
+
+struct TigAnimation {
+    unsigned effects = 0;  // TigAnimEffect bits; 0 = no animation
+    TigEasing easing = TIG_EASE_OUT;
+    int frames = 25;
+};
+
+// Where frame n puts the cached layer.
+struct TigFrameState {
+    double opacity = 1.0;
+    double dx = 0.0, dy = 0.0;  // offset as a fraction of the canvas size
+    double scale = 1.0;         // about the canvas center
+};
+
+// Parses a comma-separated effect list; false on an unknown name.
+inline bool tig_anim_parse(const std::string& list, unsigned& effects) {
+    effects = 0;
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos) comma = list.size();
+        const std::string name = list.substr(pos, comma - pos);
+        if (name == "fade-in") effects |= TIG_ANIM_FADE_IN;
+        else if (name == "fade-out") effects |= TIG_ANIM_FADE_OUT;
+        else if (name == "fade") effects |= TIG_ANIM_FADE_IN | TIG_ANIM_FADE_OUT;
+        else if (name == "slide-left") effects |= TIG_ANIM_SLIDE_LEFT;
+        else if (name == "slide-right") effects |= TIG_ANIM_SLIDE_RIGHT;
+        else if (name == "slide-up") effects |= TIG_ANIM_SLIDE_UP;
+        else if (name == "slide-down") effects |= TIG_ANIM_SLIDE_DOWN;
+        else if (name == "pop") effects |= TIG_ANIM_POP;
+        else return false;
+        pos = comma + 1;
+    }
+    return effects != 0;
+}
+
+inline bool tig_easing_parse(const std::string& name, TigEasing& easing) {
+    if (name == "linear") easing = TIG_EASE_LINEAR;
+    else if (name == "ease-in") easing = TIG_EASE_IN;
+    else if (name == "ease-out") easing = TIG_EASE_OUT;
+    else if (name == "ease-in-out") easing = TIG_EASE_IN_OUT;
+    else if (name == "back") easing = TIG_EASE_BACK;
+    else return false;
+    return true;
+}
+
+inline double tig_ease(TigEasing easing, double p) {
+    p = std::min(1.0, std::max(0.0, p));
+    const double q = 1.0 - p;
+    switch (easing) {
+        case TIG_EASE_IN: return p * p * p;
+        case TIG_EASE_OUT: return 1.0 - q * q * q;
+        case TIG_EASE_IN_OUT: return p < 0.5 ? 4.0 * p * p * p : 1.0 - 4.0 * q * q * q;
+        case TIG_EASE_BACK: {
+            const double c1 = 1.70158, c3 = c1 + 1.0;
+            return 1.0 - c3 * q * q * q + c1 * q * q;
+        }
+        default: return p;
+    }
+}
+
+inline TigFrameState tig_anim_frame(const TigAnimation& anim, int n) {
+    const double p = anim.frames > 1 ? static_cast<double>(n) / (anim.frames - 1) : 1.0;
+    TigFrameState st;
+    const unsigned fx = anim.effects;
+    const bool both = (fx & TIG_ANIM_FADE_IN) && (fx & TIG_ANIM_FADE_OUT);
+    if (fx & TIG_ANIM_FADE_IN) st.opacity *= std::min(1.0, tig_ease(anim.easing, both ? 2.0 * p : p));
+    if (fx & TIG_ANIM_FADE_OUT) st.opacity *= std::max(0.0, 1.0 - tig_ease(anim.easing, both ? 2.0 * p - 1.0 : p));
+    const double e = tig_ease(anim.easing, p);
+    const double rest = 1.0 - e;  // distance still to travel
+    if (fx & TIG_ANIM_SLIDE_LEFT) st.dx += rest;
+    if (fx & TIG_ANIM_SLIDE_RIGHT) st.dx -= rest;
+    if (fx & TIG_ANIM_SLIDE_UP) st.dy += rest;
+    if (fx & TIG_ANIM_SLIDE_DOWN) st.dy -= rest;
+    if (fx & TIG_ANIM_POP) st.scale = std::max(0.0, e);
+    st.opacity = std::min(1.0, std::max(0.0, st.opacity));
+    return st;
+}
+
+#endif  // TIG_ANIM_H
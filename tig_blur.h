@@ -0,0 +1,152 @@
+/*
+ * tig_blur.h - Gaussian-like blur of coverage planes for --shadow and --glow
+ *
+ * Three box blurs per axis approximate a Gaussian with sigma = radius / 2
+ * (box sizes as in Kutskir, "Fastest Gaussian blur"). Every box pass is a
+ * running sum down the columns, one row at a time with the box_step kernel,
+ * so its cost per pixel does not depend on the radius. Horizontal passes run
+ * the same way on the transposed plane. Column bands are split across
+ * threads with tig_parallel_for().
+ */
+
+#ifndef TIG_BLUR_H
+#define TIG_BLUR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "tig_parallel.h"
+#include "tig_simd.h"
+
+// --shadow dx,dy,radius,color / --glow radius,color (pixels at 1x)
+struct TigBlurEffect {
+    bool enabled = false;
+    double dx = 0.0, dy = 0.0;
+    double radius = 0.0;
+    uint8_t r = 0, g = 0, b = 0, a = 255;  // straight alpha
+};
+
+// Parses "dx,dy,radius,#RRGGBB[AA]" (with_offset) or "radius,#RRGGBB[AA]".
+inline bool tig_blur_effect_parse(const std::string& spec, bool with_offset, TigBlurEffect& out) {
+    const char* p = spec.c_str();
+    char* end = nullptr;
+    double numbers[3];
+    const int count = with_offset ? 3 : 1;
+    for (int i = 0; i < count; ++i) {
+        numbers[i] = std::strtod(p, &end);
+        if (end == p || *end != ',') return false;
+        p = end + 1;
+    }
+    std::string color = p;
+    if (!color.empty() && color[0] == '#') color = color.substr(1);
+    unsigned r, g, b, a = 255;
+    if (color.size() == 8) {
+        if (std::sscanf(color.c_str(), "%02x%02x%02x%02x", &r, &g, &b, &a) != 4) return false;
+    } else if (color.size() != 6 || std::sscanf(color.c_str(), "%02x%02x%02x", &r, &g, &b) != 3) {
+        return false;
+    }
+    const double radius = numbers[count - 1];
+    if (!(radius >= 0.0 && radius <= 500.0)) return false;
+    if (with_offset && !(std::fabs(numbers[0]) <= 1000.0 && std::fabs(numbers[1]) <= 1000.0)) return false;
+    out.enabled = true;
+    out.dx = with_offset ? numbers[0] : 0.0;
+    out.dy = with_offset ? numbers[1] : 0.0;
+    out.radius = radius;
+    out.r = static_cast<uint8_t>(r);
+    out.g = static_cast<uint8_t>(g);
+    out.b = static_cast<uint8_t>(b);
+    out.a = static_cast<uint8_t>(a);
+    return true;
+}
+
+// Half-widths of the three boxes for a blur of this radius.
+inline void tig_blur_boxes(double radius, int half[3]) {
+    const double sigma = radius / 2.0;
+    int lower = static_cast<int>(std::floor(std::sqrt(12.0 * sigma * sigma / 3.0 + 1.0)));
+    if (lower % 2 == 0) --lower;
+    const double ideal = (12.0 * sigma * sigma - 3.0 * lower * lower - 12.0 * lower - 9.0) / (-4.0 * lower - 4.0);
+    const int m = static_cast<int>(std::lround(ideal));
+    for (int i = 0; i < 3; ++i) half[i] = ((i < m ? lower : lower + 2) - 1) / 2;
+}
+
+// How far a blur of this radius spreads coverage, in pixels.
+inline int tig_blur_reach(double radius) {
+    int half[3];
+    tig_blur_boxes(radius, half);
+    return half[0] + half[1] + half[2];
+}
+
+namespace tig_blur_detail {
+
+// One vertical box pass of half-width r, src -> dst (w x h, packed), columns
+// [x0, x1). Rows outside the plane count as zero.
+inline void box_columns(const uint8_t* src, uint8_t* dst, int w, int h, int r, size_t x0, size_t x1) {
+    const TigKernels& kernels = tig_kernels();
+    static thread_local std::vector<uint32_t> sums;
+    static thread_local std::vector<uint8_t> zeros, scratch;
+    const size_t n = x1 - x0;
+    sums.assign(n, 0);
+    if (zeros.size() < n) zeros.assign(n, 0);
+    scratch.resize(n);
+    const uint32_t size = static_cast<uint32_t>(2 * r + 1);
+    const uint32_t mul = ((1u << 24) + size / 2) / size;
+    for (int y = 0; y <= std::min(r, h - 1); ++y) {
+        kernels.box_step(sums.data(), src + static_cast<size_t>(y) * w + x0, zeros.data(), scratch.data(), n, 0);
+    }
+    for (int y = 0; y < h; ++y) {
+        const uint8_t* add = y + r + 1 < h ? src + static_cast<size_t>(y + r + 1) * w + x0 : zeros.data();
+        const uint8_t* sub = y - r >= 0 ? src + static_cast<size_t>(y - r) * w + x0 : zeros.data();
+        kernels.box_step(sums.data(), add, sub, dst + static_cast<size_t>(y) * w + x0, n, mul);
+    }
+}
+
+// Three vertical passes; plane holds the result.
+inline void blur_columns(std::vector<uint8_t>& plane, std::vector<uint8_t>& tmp, int w, int h, const int half[3]) {
+    tmp.resize(plane.size());
+    tig_parallel_for(static_cast<size_t>(w), std::max<size_t>(64, (1u << 16) / std::max(1, h)),
+                     [&](size_t x0, size_t x1) {
+                         box_columns(plane.data(), tmp.data(), w, h, half[0], x0, x1);
+                         box_columns(tmp.data(), plane.data(), w, h, half[1], x0, x1);
+                         box_columns(plane.data(), tmp.data(), w, h, half[2], x0, x1);
+                     });
+    plane.swap(tmp);
+}
+
+// src (w x h) -> dst (h x w), in 32x32 blocks.
+inline void transpose(const uint8_t* src, uint8_t* dst, int w, int h) {
+    const int block = 32;
+    tig_parallel_for(static_cast<size_t>((h + block - 1) / block), std::max<size_t>(1, (1u << 16) / (block * std::max(1, w))),
+                     [&](size_t b0, size_t b1) {
+                         for (int y0 = static_cast<int>(b0) * block; y0 < std::min(h, static_cast<int>(b1) * block); y0 += block) {
+                             for (int x0 = 0; x0 < w; x0 += block) {
+                                 for (int y = y0; y < std::min(h, y0 + block); ++y) {
+                                     for (int x = x0; x < std::min(w, x0 + block); ++x) {
+                                         dst[static_cast<size_t>(x) * h + y] = src[static_cast<size_t>(y) * w + x];
+                                     }
+                                 }
+                             }
+                         }
+                     });
+}
+
+}  // namespace tig_blur_detail
+
+// Blurs a packed w x h 8-bit plane in place.
+inline void tig_blur_plane(std::vector<uint8_t>& plane, int w, int h, double radius) {
+    if (w <= 0 || h <= 0 || radius <= 0.0) return;
+    int half[3];
+    tig_blur_boxes(radius, half);
+    static thread_local std::vector<uint8_t> tmp, transposed;
+    tig_blur_detail::blur_columns(plane, tmp, w, h, half);
+    transposed.resize(plane.size());
+    tig_blur_detail::transpose(plane.data(), transposed.data(), w, h);
+    tig_blur_detail::blur_columns(transposed, tmp, h, w, half);
+    tig_blur_detail::transpose(transposed.data(), plane.data(), h, w);
+}
+
+#endif  // TIG_BLUR_H
@@ -0,0 +1,148 @@
+/*
+ * tig_cgroup.h - CPU and memory limits of the process's cgroup (v2)
+ *
+ * Inside a container std::thread::hardware_concurrency() reports the host's
+ * cores, not the share the container may use. The cgroup v2 interface files
+ * say what that share is:
+ *   cpu.max      "QUOTA PERIOD" allows QUOTA / PERIOD CPUs ("max" = no limit)
+ *   memory.max   bytes the group may use ("max" = no limit)
+ * Limits apply along the whole path, so the tightest one of the process's
+ * cgroup and its ancestors wins. memory.current and cpu.stat's
+ * throttled_usec of the limiting groups show how close a run is to them;
+ * the --jobs auto controller samples both. The cgroup v1 hierarchy is not
+ * read.
+ */
+
+#ifndef TIG_CGROUP_H
+#define TIG_CGROUP_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <thread>
+
+struct TigCgroup {
+    double cpus = 0.0;            // cpu.max quota in CPUs; 0 = no limit
+    uint64_t memory_max = 0;      // memory.max in bytes; 0 = no limit
+    std::string cpu_dir;          // group whose cpu.max set cpus
+    std::string memory_dir;       // group whose memory.max set memory_max
+};
+
+namespace tig_cgroup_detail {
+
+inline bool read_first_line(const std::string& path, std::string& line) {
+    std::ifstream in(path);
+    return static_cast<bool>(std::getline(in, line));
+}
+
+// Value of one "key value" line of a flat keyed file such as cpu.stat.
+inline uint64_t read_key(const std::string& path, const std::string& key) {
+    std::ifstream in(path);
+    std::string k;
+    uint64_t v = 0;
+    while (in >> k >> v) {
+        if (k == key) return v;
+    }
+    return 0;
+}
+
+}  // namespace tig_cgroup_detail
+
+// Limits along dir and its ancestors up to (and including) mount.
+inline TigCgroup tig_cgroup_read(const std::string& mount, std::string dir) {
+    using namespace tig_cgroup_detail;
+    TigCgroup cg;
+    while (true) {
+        std::string line;
+        if (read_first_line(dir + "/cpu.max", line)) {
+            std::istringstream in(line);
+            std::string quota;
+            double period = 0.0;
+            if (in >> quota >> period && quota != "max" && period > 0) {
+                const double cpus = std::strtod(quota.c_str(), nullptr) / period;
+                if (cpus > 0 && (cg.cpus == 0.0 || cpus < cg.cpus)) {
+                    cg.cpus = cpus;
+                    cg.cpu_dir = dir;
+                }
+            }
+        }
+        if (read_first_line(dir + "/memory.max", line) && line != "max") {
+            const uint64_t bytes = std::strtoull(line.c_str(), nullptr, 10);
+            if (bytes > 0 && (cg.memory_max == 0 || bytes < cg.memory_max)) {
+                cg.memory_max = bytes;
+                cg.memory_dir = dir;
+            }
+        }
+        if (dir.size() <= mount.size()) break;
+        dir.erase(dir.rfind('/'));
+        if (dir.size() < mount.size()) dir = mount;
+    }
+    return cg;
+}
+
+// The process's cgroup: the cgroup2 mount from /proc/self/mountinfo plus the
+// "0::" path from /proc/self/cgroup. Empty limits if there is no cgroup v2.
+inline const TigCgroup& tig_cgroup() {
+    static const TigCgroup cgroup = [] {
+        std::ifstream mounts("/proc/self/mountinfo");
+        std::string line, mount;
+        while (mount.empty() && std::getline(mounts, line)) {
+            // "id parent dev root mountpoint options... - fstype source superoptions"
+            const size_t sep = line.find(" - ");
+            if (sep == std::string::npos || line.compare(sep + 3, 8, "cgroup2 ") != 0) continue;
+            std::istringstream in(line);
+            std::string field;
+            for (int i = 0; i < 5 && in >> field; ++i) {
+            }
+            mount = field;
+        }
+        std::ifstream self("/proc/self/cgroup");
+        std::string path;
+        while (std::getline(self, line)) {
+            if (line.compare(0, 3, "0::") == 0) path = line.substr(3);
+        }
+        if (mount.empty() || path.empty()) return TigCgroup();
+        if (path == "/") path.clear();
+        return tig_cgroup_read(mount, mount + path);
+    }();
+    return cgroup;
+}
+
+// Bytes in use by the group that sets memory.max; 0 without a memory limit.
+inline uint64_t tig_cgroup_memory_current() {
+    const TigCgroup& cg = tig_cgroup();
+    std::string line;
+    if (cg.memory_dir.empty() || !tig_cgroup_detail::read_first_line(cg.memory_dir + "/memory.current", line)) {
+        return 0;
+    }
+    return std::strtoull(line.c_str(), nullptr, 10);
+}
+
+// Total time the CPU-limiting group was throttled; 0 without a CPU limit.
+inline uint64_t tig_cgroup_throttled_usec() {
+    const TigCgroup& cg = tig_cgroup();
+    return cg.cpu_dir.empty() ? 0 : tig_cgroup_detail::read_key(cg.cpu_dir + "/cpu.stat", "throttled_usec");
+}
+
+// CPUs this process can use: hardware threads, narrowed by the affinity
+// mask and by cpu.max (rounded up), at least 1.
+inline unsigned tig_cpu_budget() {
+    static const unsigned budget = [] {
+        unsigned n = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t set;
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            n = std::min(n, static_cast<unsigned>(std::max(1, CPU_COUNT(&set))));
+        }
+        const double cpus = tig_cgroup().cpus;
+        if (cpus > 0) n = std::min(n, static_cast<unsigned>(std::max(1.0, std::ceil(cpus))));
+        return n;
+    }();
+    return budget;
+}
+
+#endif  // TIG_CGROUP_H
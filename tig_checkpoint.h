@@ -0,0 +1,157 @@
+/*
+ * tig_checkpoint.h - Completion journal for --checkpoint and --resume
+ *
+ * After each finished line its manifest records are appended to the
+ * journal (<prefix>checkpoint.jsonl) and flushed to the OS. fsync runs at
+ * most once a second and on close, so a machine crash loses at most the
+ * last second of work. A line whose outputs did not all get written is not
+ * journaled and is rendered again.
+ *
+ * The first line is a header, {"checkpoint": 1, "options": "<hash>"}, with a
+ * hash of the render options that shape the outputs (font, size, colors,
+ * effects, SIMD level, ...). --resume refuses a journal whose hash differs,
+ * since its files would no longer match what the run renders. Otherwise it
+ * skips a line if every file it lists still exists with the recorded size
+ * and the input line still has the recorded hash; the later of two records
+ * of one line wins. SIGINT and SIGTERM only
+ * set a flag, which the render loop checks between lines, so the journal
+ * is closed cleanly; a second signal terminates at once.
+ */
+
+#ifndef TIG_CHECKPOINT_H
+#define TIG_CHECKPOINT_H
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "tig_manifest.h"
+#include "tig_shard.h"
+
+// <prefix>checkpoint.jsonl, or <prefix>checkpoint-shard-IofN.jsonl per shard.
+inline std::string tig_checkpoint_name(const std::string& prefix, const TigShard& shard) {
+    if (shard.count <= 1) return prefix + "checkpoint.jsonl";
+    return prefix + "checkpoint-shard-" + std::to_string(shard.index) + "of" + std::to_string(shard.count) + ".jsonl";
+}
+
+// Signal number that asked the render loop to stop, 0 while running.
+inline volatile std::sig_atomic_t& tig_stop_signal() {
+    static volatile std::sig_atomic_t signal_number = 0;
+    return signal_number;
+}
+
+inline void tig_install_stop_handlers() {
+    struct sigaction sa = {};
+    sa.sa_handler = [](int sig) { tig_stop_signal() = sig; };
+    sa.sa_flags = SA_RESETHAND;  // the next signal takes the default action
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+}
+
+class TigCheckpoint {
+public:
+    ~TigCheckpoint() { close(); }
+
+    // Opens the journal for appending. With resume the existing records are
+    // loaded first, if the journal was written with the same options hash;
+    // otherwise the journal starts empty.
+    bool open(const std::string& path, bool resume, uint64_t options, std::string& error) {
+        if (resume) {
+            std::ifstream in(path);
+            std::string header;
+            if (in.is_open() && std::getline(in, header) && !header.empty() && header_options(header) != options) {
+                error = "Checkpoint " + path + " was written with different render options; run without --resume "
+                        "to start over";
+                return false;
+            }
+            std::vector<TigManifestEntry> entries;
+            if (tig_manifest_load(path, entries)) {
+                int last = 0;
+                for (const TigManifestEntry& e : entries) {
+                    std::vector<TigManifestEntry>& group = lines_[e.line];
+                    if (e.line != last) group.clear();
+                    group.push_back(e);
+                    last = e.line;
+                }
+            }
+        }
+        file_ = std::fopen(path.c_str(), resume ? "a+" : "w");
+        if (!file_) {
+            error = "Could not open checkpoint: " + path;
+            return false;
+        }
+        // Terminate a record torn by a crash, so the next one starts on its own line
+        if (std::fseek(file_, -1, SEEK_END) == 0 && std::fgetc(file_) != '\n') std::fputc('\n', file_);
+        std::fseek(file_, 0, SEEK_END);
+        if (std::ftell(file_) == 0) {
+            char hash[17];
+            std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(options));
+            std::fprintf(file_, "{\"checkpoint\": 1, \"options\": \"%s\"}\n", hash);
+        }
+        last_sync_ = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    // The journaled records of line if its outputs are intact, else null.
+    const std::vector<TigManifestEntry>* done(int line, uint64_t text_hash) const {
+        auto it = lines_.find(line);
+        if (it == lines_.end()) return nullptr;
+        for (const TigManifestEntry& e : it->second) {
+            if (e.text_hash != text_hash) return nullptr;
+            if (!e.same_as.empty()) continue;  // --delta duplicate frame, no file of its own
+            struct stat st;
+            if (e.bytes == 0 || stat(e.file.c_str(), &st) != 0 || static_cast<uint64_t>(st.st_size) != e.bytes) {
+                return nullptr;
+            }
+        }
+        return &it->second;
+    }
+
+    size_t size() const { return lines_.size(); }
+
+    // Journals one finished line.
+    bool record(const std::vector<TigManifestEntry>& entries) {
+        bool ok = true;
+        for (const TigManifestEntry& e : entries) {
+            ok = ok && std::fprintf(file_, "%s\n", tig_manifest_format(e).c_str()) > 0;
+        }
+        ok = std::fflush(file_) == 0 && ok;
+        const auto now = std::chrono::steady_clock::now();
+        if (now - last_sync_ >= std::chrono::seconds(1)) {
+            fsync(fileno(file_));
+            last_sync_ = now;
+        }
+        return ok;
+    }
+
+    bool close() {
+        if (!file_) return true;
+        const bool ok = std::fflush(file_) == 0 && fsync(fileno(file_)) == 0;
+        const bool closed = std::fclose(file_) == 0;
+        file_ = nullptr;
+        return ok && closed;
+    }
+
+private:
+    // The options hash of a header line, 0 if line is not a header.
+    static uint64_t header_options(const std::string& line) {
+        const std::string key = "\"options\": \"";
+        const size_t pos = line.find(key);
+        if (line.find("\"checkpoint\"") == std::string::npos || pos == std::string::npos) return 0;
+        return std::strtoull(line.c_str() + pos + key.size(), nullptr, 16);
+    }
+
+    std::FILE* file_ = nullptr;
+    std::map<int, std::vector<TigManifestEntry>> lines_;
+    std::chrono::steady_clock::time_point last_sync_;
+};
+
+#endif  // TIG_CHECKPOINT_H
@@ -0,0 +1,234 @@
+/*
+ * tig_karaoke.h - Karaoke timing for text2png --karaoke
+ *
+ * Parses one input line into plain text plus timed syllables. Accepted forms:
+ *   Enhanced LRC: [00:12.34]<00:12.34>Hel<00:12.80>lo <00:13.10>world<00:14.00>
+ *                 Each <time> starts the text after it; a trailing <time> is
+ *                 the end. A plain [time]text line sweeps over one second.
+ *   ASS:          Dialogue: 0,0:00:12.34,0:00:15.00,Default,,0,0,0,,{\k50}Hel{\k30}lo
+ *                 \k and \ko switch a syllable at its start, \kf and \K sweep it
+ *                 over its duration (centiseconds). Other override tags are
+ *                 dropped, \N and \h become spaces. A bare "{\k..}" line
+ *                 without the Dialogue fields starts at 0.
+ */
+
+#ifndef TIG_KARAOKE_H
+#define TIG_KARAOKE_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+struct TigSyllable {
+    size_t byte_begin = 0;  // range in TigKaraokeLine::text
+    size_t byte_end = 0;
+    int64_t start_ms = 0;
+    int64_t end_ms = 0;
+    bool sweep = false;  // fill cluster by cluster over the duration instead of at once
+};
+
+struct TigKaraokeLine {
+    std::string text;  // the line with all timing and override tags removed
+    int64_t start_ms = 0;
+    int64_t end_ms = 0;
+    std::vector<TigSyllable> syllables;
+};
+
+// Duration given to a last syllable that has no end time
+static const int64_t kTigKaraokeTailMs = 1000;
+
+// "mm:ss.xx", "mm:ss.xxx" or "h:mm:ss.cc" -> milliseconds
+inline bool tig_parse_clock(const std::string& s, int64_t& ms) {
+    double total = 0.0;
+    size_t pos = 0;
+    int fields = 0;
+    while (pos <= s.size()) {
+        size_t colon = s.find(':', pos);
+        std::string part = s.substr(pos, colon == std::string::npos ? std::string::npos : colon - pos);
+        char* end = nullptr;
+        double v = std::strtod(part.c_str(), &end);
+        if (part.empty() || *end != '\0' || v < 0.0) return false;
+        total = total * 60.0 + v;
+        ++fields;
+        if (colon == std::string::npos) break;
+        pos = colon + 1;
+    }
+    if (fields < 2 || fields > 3) return false;
+    ms = static_cast<int64_t>(std::llround(total * 1000.0));
+    return true;
+}
+
+namespace tig_karaoke_detail {
+
+struct Marker {
+    size_t byte;
+    int64_t start_ms;
+    int64_t duration_ms;  // -1: until the next marker
+    bool sweep;
+};
+
+// Turns tag positions into syllables; text before the first marker starts with the line.
+inline void build_syllables(TigKaraokeLine& out, std::vector<Marker>& markers, int64_t end_ms) {
+    if (markers.empty() || markers.front().byte > 0) {
+        markers.insert(markers.begin(), {0, out.start_ms, markers.empty() ? -1 : 0, markers.empty()});
+    }
+    for (size_t i = 0; i < markers.size(); ++i) {
+        TigSyllable syl;
+        syl.byte_begin = markers[i].byte;
+        syl.byte_end = i + 1 < markers.size() ? markers[i + 1].byte : out.text.size();
+        syl.start_ms = markers[i].start_ms;
+        if (markers[i].duration_ms >= 0) {
+            syl.end_ms = syl.start_ms + markers[i].duration_ms;
+        } else if (i + 1 < markers.size()) {
+            syl.end_ms = markers[i + 1].start_ms;
+        } else {
+            syl.end_ms = end_ms > syl.start_ms ? end_ms : syl.start_ms + kTigKaraokeTailMs;
+        }
+        syl.sweep = markers[i].sweep;
+        if (syl.byte_end > syl.byte_begin) out.syllables.push_back(syl);
+    }
+    out.end_ms = end_ms;
+    for (const TigSyllable& syl : out.syllables) {
+        if (syl.end_ms > out.end_ms) out.end_ms = syl.end_ms;
+    }
+}
+
+inline bool parse_lrc(const std::string& line, TigKaraokeLine& out) {
+    size_t pos = 0;
+    bool timed = false;
+    while (pos < line.size() && line[pos] == '[') {
+        size_t close = line.find(']', pos);
+        if (close == std::string::npos) return false;
+        int64_t ms;
+        if (!timed && tig_parse_clock(line.substr(pos + 1, close - pos - 1), ms)) {
+            out.start_ms = ms;
+            timed = true;
+        }
+        pos = close + 1;
+    }
+    if (!timed) return false;
+
+    std::vector<Marker> markers;
+    int64_t end_ms = -1;
+    while (pos < line.size()) {
+        size_t close = line[pos] == '<' ? line.find('>', pos) : std::string::npos;
+        int64_t ms;
+        if (close != std::string::npos && tig_parse_clock(line.substr(pos + 1, close - pos - 1), ms)) {
+            markers.push_back({out.text.size(), ms, -1, false});
+            pos = close + 1;
+            continue;
+        }
+        out.text += line[pos++];
+    }
+    // A marker after the last character only closes the previous syllable
+    if (!markers.empty() && markers.back().byte == out.text.size()) {
+        end_ms = markers.back().start_ms;
+        markers.pop_back();
+    }
+    build_syllables(out, markers, end_ms);
+    return true;
+}
+
+inline bool parse_ass(const std::string& line, TigKaraokeLine& out) {
+    std::string text = line;
+    int64_t end_ms = -1;
+    if (line.compare(0, 9, "Dialogue:") == 0) {
+        // Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text
+        std::vector<std::string> fields;
+        size_t pos = 9;
+        for (int f = 0; f < 9; ++f) {
+            size_t comma = line.find(',', pos);
+            if (comma == std::string::npos) return false;
+            fields.push_back(line.substr(pos, comma - pos));
+            pos = comma + 1;
+        }
+        auto trim = [](std::string s) {
+            s.erase(0, s.find_first_not_of(' '));
+            s.erase(s.find_last_not_of(' ') + 1);
+            return s;
+        };
+        if (!tig_parse_clock(trim(fields[1]), out.start_ms) || !tig_parse_clock(trim(fields[2]), end_ms)) {
+            return false;
+        }
+        text = line.substr(pos);
+    } else if (line.find("{\\k") == std::string::npos && line.find("{\\K") == std::string::npos) {
+        return false;
+    }
+
+    std::vector<Marker> markers;
+    int64_t cursor = out.start_ms;
+    for (size_t pos = 0; pos < text.size();) {
+        if (text[pos] == '{') {
+            size_t close = text.find('}', pos);
+            if (close == std::string::npos) close = text.size();
+            for (size_t t = text.find('\\', pos); t < close; t = text.find('\\', t + 1)) {
+                size_t name = t + 1;
+                if (name >= close || (text[name] != 'k' && text[name] != 'K')) continue;
+                bool sweep = text[name] == 'K';
+                size_t num = name + 1;
+                if (num < close && text[num] == 'f') {
+                    sweep = true;
+                    ++num;
+                } else if (num < close && text[num] == 'o') {
+                    ++num;
+                }
+                char* end = nullptr;
+                long cs = std::strtol(text.c_str() + num, &end, 10);
+                if (end == text.c_str() + num || cs < 0) continue;
+                markers.push_back({out.text.size(), cursor, cs * 10, sweep});
+                cursor += cs * 10;
+            }
+            pos = close + 1;
+        } else if (text[pos] == '\\' && pos + 1 < text.size() &&
+                   (text[pos + 1] == 'N' || text[pos + 1] == 'n' || text[pos + 1] == 'h')) {
+            out.text += ' ';
+            pos += 2;
+        } else {
+            out.text += text[pos++];
+        }
+    }
+    // Untagged dialogue sweeps over its whole display time
+    if (markers.empty() && end_ms > out.start_ms) markers.push_back({0, out.start_ms, end_ms - out.start_ms, true});
+    build_syllables(out, markers, end_ms);
+    return true;
+}
+
+}  // namespace tig_karaoke_detail
+
+// Returns false (out is cleared) if the line carries no timing at all.
+inline bool tig_karaoke_parse(const std::string& line, TigKaraokeLine& out) {
+    out = TigKaraokeLine();
+    if (tig_karaoke_detail::parse_lrc(line, out)) return true;
+    out = TigKaraokeLine();
+    if (tig_karaoke_detail::parse_ass(line, out)) return true;
+    out = TigKaraokeLine();
+    return false;
+}
+
+// Number of leading text bytes shown highlighted at t_ms. Always a cluster
+// boundary: cluster_begins holds the first byte of every glyph cluster in
+// ascending order, and a sweeping syllable advances one cluster at a time.
+inline size_t tig_karaoke_highlight_bytes(const TigKaraokeLine& line, int64_t t_ms,
+                                          const std::vector<size_t>& cluster_begins) {
+    size_t bytes = 0;
+    for (const TigSyllable& syl : line.syllables) {
+        if (t_ms < syl.start_ms) break;
+        if (!syl.sweep || t_ms >= syl.end_ms) {
+            bytes = syl.byte_end;
+            continue;
+        }
+        size_t first = 0, count = 0;
+        for (size_t i = 0; i < cluster_begins.size(); ++i) {
+            if (cluster_begins[i] < syl.byte_begin) first = i + 1;
+            else if (cluster_begins[i] < syl.byte_end) ++count;
+        }
+        const size_t lit = static_cast<size_t>(count * (t_ms - syl.start_ms) / (syl.end_ms - syl.start_ms));
+        bytes = lit < count ? cluster_begins[first + lit] : syl.byte_end;
+        break;
+    }
+    return bytes;
+}
+
+#endif  // TIG_KARAOKE_H
@@ -0,0 +1,200 @@
+/*
+ * tig_manifest.h - Output manifest for text2png and txt2png runs (JSON Lines)
+ *
+ * One record per written image:
+ *   {"line": 12, "file": "out-12.png", "text": "9f3c...", "width": 412,
+ *    "height": 112, "bytes": 5310, "proxy": 0}
+ * "text" is a 64-bit FNV-1a hash of the source line (hex), "proxy" the
+ * downscale factor of a --proxy render (0 = full quality). Readers ignore
+ * unknown keys, so fields can be added without breaking older manifests.
+ *
+ * --delta frame sequences add, only where they apply:
+ *   "delta": 1, "x": 40, "y": 12   the file is the rectangle at (x, y) that
+ *                                  changed since the previous frame
+ *   "same_as": "out-3-00004.png"   no file was written; the frame equals the
+ *                                  previous one, last written as that file
+ *
+ * --shard runs write one partial manifest per node; tig_manifest_merge()
+ * joins them into one ordered by line.
+ */
+
+#ifndef TIG_MANIFEST_H
+#define TIG_MANIFEST_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+struct TigManifestEntry {
+    int line = 0;
+    std::string file;
+    uint64_t text_hash = 0;
+    int width = 0;
+    int height = 0;
+    uint64_t bytes = 0;
+    int proxy = 0;
+    bool delta = false;
+    int x = 0;
+    int y = 0;
+    std::string same_as;
+};
+
+inline uint64_t tig_text_hash(const std::string& text) {
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : text) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+inline std::string tig_json_quote(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char tmp[8];
+            std::snprintf(tmp, sizeof(tmp), "\\u%04x", c);
+            out += tmp;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+inline std::string tig_manifest_format(const TigManifestEntry& e) {
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(e.text_hash));
+    char nums[160];
+    std::snprintf(nums, sizeof(nums), ", \"width\": %d, \"height\": %d, \"bytes\": %llu, \"proxy\": %d",
+                  e.width, e.height, static_cast<unsigned long long>(e.bytes), e.proxy);
+    std::string record = "{\"line\": " + std::to_string(e.line) + ", \"file\": " + tig_json_quote(e.file) +
+                         ", \"text\": \"" + hash + "\"" + nums;
+    if (e.delta) record += ", \"delta\": 1, \"x\": " + std::to_string(e.x) + ", \"y\": " + std::to_string(e.y);
+    if (!e.same_as.empty()) record += ", \"same_as\": " + tig_json_quote(e.same_as);
+    return record + "}";
+}
+
+// Parses one record written by tig_manifest_format(): a flat object of string
+// and integer values. Returns false for blank or malformed lines.
+inline bool tig_manifest_parse(const std::string& line, TigManifestEntry& e) {
+    e = TigManifestEntry();
+    size_t i = line.find('{');
+    if (i == std::string::npos) return false;
+    ++i;
+    auto skip_ws = [&] { while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) ++i; };
+    auto read_string = [&](std::string& out) {
+        if (i >= line.size() || line[i] != '"') return false;
+        out.clear();
+        for (++i; i < line.size() && line[i] != '"'; ++i) {
+            if (line[i] == '\\' && i + 1 < line.size()) {
+                ++i;
+                if (line[i] == 'u' && i + 4 < line.size()) {
+                    out += static_cast<char>(std::strtol(line.substr(i + 1, 4).c_str(), nullptr, 16));
+                    i += 4;
+                    continue;
+                }
+            }
+            out += line[i];
+        }
+        if (i >= line.size()) return false;
+        ++i;
+        return true;
+    };
+    bool have_line = false, have_file = false;
+    while (true) {
+        skip_ws();
+        if (i < line.size() && line[i] == '}') break;
+        std::string key, str;
+        if (!read_string(key)) return false;
+        skip_ws();
+        if (i >= line.size() || line[i] != ':') return false;
+        ++i;
+        skip_ws();
+        if (i < line.size() && line[i] == '"') {
+            if (!read_string(str)) return false;
+            if (key == "file") { e.file = str; have_file = true; }
+            else if (key == "text") e.text_hash = std::strtoull(str.c_str(), nullptr, 16);
+            else if (key == "same_as") e.same_as = str;
+        } else {
+            char* end = nullptr;
+            long long v = std::strtoll(line.c_str() + i, &end, 10);
+            if (end == line.c_str() + i) return false;
+            i = static_cast<size_t>(end - line.c_str());
+            if (key == "line") { e.line = static_cast<int>(v); have_line = true; }
+            else if (key == "width") e.width = static_cast<int>(v);
+            else if (key == "height") e.height = static_cast<int>(v);
+            else if (key == "bytes") e.bytes = static_cast<uint64_t>(v);
+            else if (key == "proxy") e.proxy = static_cast<int>(v);
+            else if (key == "delta") e.delta = v != 0;
+            else if (key == "x") e.x = static_cast<int>(v);
+            else if (key == "y") e.y = static_cast<int>(v);
+        }
+        skip_ws();
+        if (i < line.size() && line[i] == ',') ++i;
+    }
+    return have_line && have_file;
+}
+
+// Reads every record; malformed lines (e.g. a torn last write) are skipped.
+inline bool tig_manifest_load(const std::string& path, std::vector<TigManifestEntry>& entries) {
+    std::ifstream in(path);
+    if (!in.is_open()) return false;
+    std::string line;
+    TigManifestEntry e;
+    while (std::getline(in, line)) {
+        if (tig_manifest_parse(line, e)) entries.push_back(e);
+    }
+    return true;
+}
+
+// Rewrites path atomically (temp file + rename), so readers never see a
+// half-written manifest.
+inline bool tig_manifest_save(const std::string& path, const std::vector<TigManifestEntry>& entries) {
+    const std::string tmp = path + ".tmp";
+    FILE* f = std::fopen(tmp.c_str(), "w");
+    if (!f) return false;
+    bool ok = true;
+    for (const TigManifestEntry& e : entries) {
+        ok = ok && std::fprintf(f, "%s\n", tig_manifest_format(e).c_str()) > 0;
+    }
+    ok = std::fclose(f) == 0 && ok;
+    return ok && std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// Combines partial manifests into out, ordered by line (a line's records keep
+// their order). Fails with a message if a part is unreadable or two parts
+// list the same file, i.e. the shards overlapped.
+inline bool tig_manifest_merge(const std::vector<std::string>& parts, const std::string& out, std::string& error) {
+    std::vector<TigManifestEntry> entries;
+    for (const std::string& part : parts) {
+        if (!tig_manifest_load(part, entries)) {
+            error = "Could not read manifest: " + part;
+            return false;
+        }
+    }
+    std::set<std::string> files;
+    for (const TigManifestEntry& e : entries) {
+        if (!files.insert(e.file).second) {
+            error = "File listed by more than one part: " + e.file;
+            return false;
+        }
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const TigManifestEntry& a, const TigManifestEntry& b) { return a.line < b.line; });
+    if (!tig_manifest_save(out, entries)) {
+        error = "Error writing manifest: " + out;
+        return false;
+    }
+    return true;
+}
+
+#endif  // TIG_MANIFEST_H
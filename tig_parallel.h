@@ -0,0 +1,49 @@
+/*
+ * tig_parallel.h - Splitting one image operation across threads
+ *
+ * tig_parallel_for() cuts [0, n) into contiguous chunks and runs them on
+ * short-lived std::threads, the caller taking the first chunk. Chunks are at
+ * least min_chunk long, so small images never pay for a thread start and run
+ * inline. Used by the blur passes of --shadow/--glow. Threads that already
+ * render one of several lines at once (--jobs) run it inline as well.
+ */
+
+#ifndef TIG_PARALLEL_H
+#define TIG_PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "tig_cgroup.h"
+
+// Threads an operation may use: the CPUs the affinity mask and cgroup quota leave.
+inline unsigned tig_worker_count() {
+    return tig_cpu_budget();
+}
+
+// Set on the line workers of --jobs, whose image operations then stay on their thread.
+inline bool& tig_parallel_inline() {
+    static thread_local bool value = false;
+    return value;
+}
+
+// fn(begin, end) for disjoint ranges covering [0, n); returns when all are done.
+template <typename Fn>
+inline void tig_parallel_for(size_t n, size_t min_chunk, Fn fn) {
+    const size_t chunks = std::min<size_t>(tig_worker_count(), std::max<size_t>(1, n / std::max<size_t>(1, min_chunk)));
+    if (chunks <= 1 || tig_parallel_inline()) {
+        if (n) fn(size_t(0), n);
+        return;
+    }
+    std::vector<std::thread> threads;
+    threads.reserve(chunks - 1);
+    for (size_t c = 1; c < chunks; ++c) {
+        threads.emplace_back([&fn, c, n, chunks] { fn(n * c / chunks, n * (c + 1) / chunks); });
+    }
+    fn(0, n / chunks);
+    for (std::thread& t : threads) t.join();
+}
+
+#endif  // TIG_PARALLEL_H
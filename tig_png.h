@@ -0,0 +1,245 @@
+/*
+ * tig_png.h - PNG encoder for cairo ARGB32 surfaces
+ *
+ * Replaces cairo_surface_write_to_png_stream(): rows are unpremultiplied with
+ * the dispatched tig_simd.h kernel (cairo does this per pixel in scalar code)
+ * and handed to libpng, which also lets callers pick the zlib level. Output is
+ * 8-bit RGBA with the same pixel values cairo would have written.
+ * tig_apng_assemble() stitches such PNGs into one animated PNG, and
+ * tig_png_decode() reads any PNG back into a premultiplied ARGB32 surface.
+ */
+
+#ifndef TIG_PNG_H
+#define TIG_PNG_H
+
+#include <cairo.h>
+#include <png.h>
+#include <csetjmp>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "tig_simd.h"
+
+inline void tig_png_append(png_structp png, png_bytep data, png_size_t length) {
+    std::vector<unsigned char>* out = static_cast<std::vector<unsigned char>*>(png_get_io_ptr(png));
+    out->insert(out->end(), data, data + length);
+}
+
+inline void tig_png_flush(png_structp) {}
+
+// Appends the encoded surface to out. compression is a zlib level (0-9) or -1
+// for libpng's default. Returns false on a libpng error.
+inline bool tig_png_encode(cairo_surface_t* surface, std::vector<unsigned char>& out, int compression = -1) {
+    cairo_surface_flush(surface);
+    const int width = cairo_image_surface_get_width(surface);
+    const int height = cairo_image_surface_get_height(surface);
+    const int stride = cairo_image_surface_get_stride(surface);
+    const unsigned char* data = cairo_image_surface_get_data(surface);
+    if (!data || width <= 0 || height <= 0) return false;
+
+    // Declared before setjmp so a longjmp out of libpng skips no destructors.
+    static thread_local std::vector<uint8_t> row;
+    row.resize(static_cast<size_t>(width) * 4);
+    const TigKernels& kernels = tig_kernels();
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    if (!png) return false;
+    png_infop info = png_create_info_struct(png);
+    if (!info || setjmp(png_jmpbuf(png))) {
+        png_destroy_write_struct(&png, &info);
+        return false;
+    }
+
+    png_set_write_fn(png, &out, tig_png_append, tig_png_flush);
+    if (compression >= 0) png_set_compression_level(png, compression);
+    // At the fast levels the per-row filter search costs more than it saves.
+    if (compression >= 0 && compression <= 1) png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+    png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    for (int y = 0; y < height; ++y) {
+        kernels.argb32_to_rgba(reinterpret_cast<const uint32_t*>(data + static_cast<size_t>(y) * stride),
+                               row.data(), static_cast<size_t>(width));
+        png_write_row(png, row.data());
+    }
+    png_write_end(png, info);
+    png_destroy_write_struct(&png, &info);
+    return true;
+}
+
+// Straight-alpha RGBA bytes -> cairo ARGB32 (premultiplied, rounded to nearest).
+inline void tig_rgba_to_argb32(const uint8_t* src, uint32_t* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i, src += 4) {
+        const uint32_t a = src[3];
+        if (a == 255) {
+            dst[i] = 0xFF000000u | (uint32_t(src[0]) << 16) | (uint32_t(src[1]) << 8) | src[2];
+            continue;
+        }
+        dst[i] = (a << 24) | (tig_div255(src[0] * a) << 16) | (tig_div255(src[1] * a) << 8) | tig_div255(src[2] * a);
+    }
+}
+
+// Reads a PNG of any color type and bit depth into a new ARGB32 surface, or
+// returns nullptr.
+inline cairo_surface_t* tig_png_decode(const char* path) {
+    FILE* fp = std::fopen(path, "rb");
+    if (!fp) return nullptr;
+    // As in the encoder: nothing with a destructor lives past setjmp, and
+    // surface is volatile because it changes after it.
+    static thread_local std::vector<uint8_t> row;
+    static thread_local std::vector<png_bytep> rows;
+    cairo_surface_t* volatile surface = nullptr;
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png ? png_create_info_struct(png) : nullptr;
+    if (!info || setjmp(png_jmpbuf(png))) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        if (surface) cairo_surface_destroy(surface);
+        std::fclose(fp);
+        return nullptr;
+    }
+
+    png_init_io(png, fp);
+    png_read_info(png, info);
+    png_set_expand(png);
+    png_set_strip_16(png);
+    png_set_gray_to_rgb(png);
+    png_set_add_alpha(png, 0xFF, PNG_FILLER_AFTER);
+    png_set_interlace_handling(png);
+    png_read_update_info(png, info);
+    const int width = static_cast<int>(png_get_image_width(png, info));
+    const int height = static_cast<int>(png_get_image_height(png, info));
+    surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+    if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) png_error(png, "surface");
+    const int stride = cairo_image_surface_get_stride(surface);
+    unsigned char* data = cairo_image_surface_get_data(surface);
+    // Interlaced images need every row in memory; decode straight into the
+    // surface and convert in place (the RGBA row is never wider than stride).
+    rows.resize(static_cast<size_t>(height));
+    for (int y = 0; y < height; ++y) rows[y] = data + static_cast<size_t>(y) * stride;
+    png_read_image(png, rows.data());
+    png_read_end(png, nullptr);
+    row.resize(static_cast<size_t>(width) * 4);
+    for (int y = 0; y < height; ++y) {
+        std::memcpy(row.data(), rows[y], row.size());
+        tig_rgba_to_argb32(row.data(), reinterpret_cast<uint32_t*>(rows[y]), static_cast<size_t>(width));
+    }
+    png_destroy_read_struct(&png, &info, nullptr);
+    std::fclose(fp);
+    cairo_surface_mark_dirty(surface);
+    return surface;
+}
+
+inline void tig_png_put32(std::vector<unsigned char>& out, uint32_t v) {
+    const unsigned char b[4] = {static_cast<unsigned char>(v >> 24), static_cast<unsigned char>(v >> 16),
+                                static_cast<unsigned char>(v >> 8), static_cast<unsigned char>(v)};
+    out.insert(out.end(), b, b + 4);
+}
+
+// PNG chunk CRC (ISO 3309); zlib's crc32() is not a link dependency here.
+inline uint32_t tig_png_crc(const unsigned char* data, size_t length) {
+    static const struct Table {
+        uint32_t v[256];
+        Table() {
+            for (uint32_t n = 0; n < 256; ++n) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                v[n] = c;
+            }
+        }
+    } table;
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; ++i) c = table.v[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+inline void tig_png_chunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, size_t length) {
+    tig_png_put32(out, static_cast<uint32_t>(length));
+    const size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    if (length) out.insert(out.end(), data, data + length);
+    tig_png_put32(out, tig_png_crc(out.data() + start, length + 4));
+}
+
+struct TigApngFrame {
+    std::vector<unsigned char> png;  // as written by tig_png_encode()
+    uint32_t x = 0, y = 0;           // placement; frame 0 must cover the canvas
+    uint16_t delay = 1;              // in units of delay_den
+};
+
+// Builds an APNG from encoded frames: frame 0 keeps its IDAT chunks (the
+// default image) and sets the canvas size, later frames' IDAT data is
+// rewrapped as fdAT. Each frame replaces its rectangle (blend source,
+// dispose none), so later frames can be just the part that changed.
+// plays 0 loops forever.
+inline bool tig_apng_assemble(const std::vector<TigApngFrame>& frames, uint16_t delay_den, unsigned plays,
+                              std::vector<unsigned char>& out) {
+    static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    out.clear();
+    if (frames.empty() || frames[0].x != 0 || frames[0].y != 0) return false;
+    out.insert(out.end(), signature, signature + 8);
+    uint32_t sequence = 0, canvas_w = 0, canvas_h = 0, width = 0, height = 0;
+    std::vector<unsigned char> payload;
+    for (size_t f = 0; f < frames.size(); ++f) {
+        const std::vector<unsigned char>& png = frames[f].png;
+        if (png.size() < 8 || std::memcmp(png.data(), signature, 8) != 0) return false;
+        bool wrote_fctl = false;
+        for (size_t pos = 8; pos + 12 <= png.size();) {
+            const unsigned char* p = png.data() + pos;
+            const uint32_t length = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+            if (pos + 12 + length > png.size()) return false;
+            const char* type = reinterpret_cast<const char*>(p + 4);
+            const unsigned char* data = p + 8;
+            pos += 12 + length;
+            if (std::memcmp(type, "IHDR", 4) == 0) {
+                if (length < 8) return false;
+                const uint32_t w = (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | data[3];
+                const uint32_t h = (uint32_t(data[4]) << 24) | (uint32_t(data[5]) << 16) | (uint32_t(data[6]) << 8) | data[7];
+                width = w;
+                height = h;
+                if (f == 0) {
+                    canvas_w = w;
+                    canvas_h = h;
+                    tig_png_chunk(out, "IHDR", data, length);
+                    payload.clear();
+                    tig_png_put32(payload, static_cast<uint32_t>(frames.size()));
+                    tig_png_put32(payload, plays);
+                    tig_png_chunk(out, "acTL", payload.data(), payload.size());
+                } else if (frames[f].x + w > canvas_w || frames[f].y + h > canvas_h) {
+                    return false;
+                }
+            } else if (std::memcmp(type, "IDAT", 4) == 0) {
+                if (!wrote_fctl) {
+                    payload.clear();
+                    tig_png_put32(payload, sequence++);
+                    tig_png_put32(payload, width);
+                    tig_png_put32(payload, height);
+                    tig_png_put32(payload, frames[f].x);
+                    tig_png_put32(payload, frames[f].y);
+                    payload.push_back(static_cast<unsigned char>(frames[f].delay >> 8));
+                    payload.push_back(static_cast<unsigned char>(frames[f].delay));
+                    payload.push_back(static_cast<unsigned char>(delay_den >> 8));
+                    payload.push_back(static_cast<unsigned char>(delay_den));
+                    payload.push_back(0);  // dispose: none
+                    payload.push_back(0);  // blend: source
+                    tig_png_chunk(out, "fcTL", payload.data(), payload.size());
+                    wrote_fctl = true;
+                }
+                if (f == 0) {
+                    tig_png_chunk(out, "IDAT", data, length);
+                } else {
+                    payload.clear();
+                    tig_png_put32(payload, sequence++);
+                    payload.insert(payload.end(), data, data + length);
+                    tig_png_chunk(out, "fdAT", payload.data(), payload.size());
+                }
+            }
+        }
+        if (!wrote_fctl) return false;
+    }
+    tig_png_chunk(out, "IEND", nullptr, 0);
+    return true;
+}
+
+#endif  // TIG_PNG_H
@@ -0,0 +1,35 @@
+/*
+ * tig_probes.h - USDT (SystemTap/DTrace-style) static probes for text2png
+ *
+ * Probes compile to a single nop plus an ELF note when <sys/sdt.h> is
+ * available, so they cost nothing until bpftrace/perf/systemtap attaches.
+ * Without the header (or with -DTIG_NO_USDT) they expand to nothing.
+ *
+ * Provider "text2png"; every probe fires when its stage completes:
+ *   line__start(line, text_bytes)
+ *   font__resolve(line, font_file)         font_file: const char*, NULL if not found
+ *   rasterize(line, surface_bytes)
+ *   encode(line, png_bytes)
+ *   write(line, png_bytes)
+ *   line__end(line, png_bytes)             png_bytes is 0 on failure
+ *
+ * Example: bpftrace -e 'usdt:./bin/text2png:text2png:encode { @png = hist(arg1); }'
+ */
+
+#ifndef TIG_PROBES_H
+#define TIG_PROBES_H
+
+#if !defined(TIG_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define TIG_HAVE_USDT 1
+#endif
+#endif
+
+#ifdef TIG_HAVE_USDT
+#define TIG_PROBE2(name, a, b) DTRACE_PROBE2(text2png, name, a, b)
+#else
+#define TIG_PROBE2(name, a, b) do { (void)(a); (void)(b); } while (0)
+#endif
+
+#endif  // TIG_PROBES_H
@@ -0,0 +1,144 @@
+/*
+ * tig_progress.h - Rate-limited batch progress line for text2png and txt2png
+ *
+ * The render loop only bumps two atomics per line; a background thread wakes a
+ * few times per second and prints lines done/total, an EWMA of lines/sec, ETA
+ * and bytes written. On a terminal the line is rewritten in place with '\r',
+ * otherwise (logs, CI) a plain line is emitted at most every few seconds.
+ */
+
+#ifndef TIG_PROGRESS_H
+#define TIG_PROGRESS_H
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+class TigProgress {
+public:
+    explicit TigProgress(uint64_t total, FILE* out = stderr)
+        : total_(total), out_(out), tty_(isatty(fileno(out)) != 0) {}
+
+    ~TigProgress() { stop(); }
+
+    TigProgress(const TigProgress&) = delete;
+    TigProgress& operator=(const TigProgress&) = delete;
+
+    void start() {
+        start_ = last_ = std::chrono::steady_clock::now();
+        thread_ = std::thread([this] { run(); });
+    }
+
+    // Raises the total, for work that is only known while running (--queue
+    // chunks are counted as they are claimed).
+    void add_total(uint64_t lines) { total_.fetch_add(lines, std::memory_order_relaxed); }
+
+    // Hot path: called once per finished line.
+    void add(uint64_t lines, uint64_t bytes) {
+        done_.fetch_add(lines, std::memory_order_relaxed);
+        bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    // Prints the final line and joins the reporter thread. Idempotent.
+    void stop() {
+        if (!thread_.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+        report(true);
+    }
+
+    // Non-empty lines in a file, for the "total" column. text2png renders every
+    // non-empty line; txt2png additionally skips whitespace-only lines (trim).
+    static uint64_t count_lines(const std::string& path, bool skip_blank) {
+        std::ifstream in(path);
+        std::string line;
+        uint64_t n = 0;
+        while (std::getline(in, line)) {
+            if (skip_blank ? line.find_first_not_of(" \t\r\n\f\v") != std::string::npos : !line.empty()) ++n;
+        }
+        return n;
+    }
+
+private:
+    void run() {
+        const auto interval = std::chrono::milliseconds(tty_ ? 250 : 5000);
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!cv_.wait_for(lock, interval, [this] { return stopping_; })) {
+            report(false);
+        }
+    }
+
+    void report(bool final_line) {
+        const auto now = std::chrono::steady_clock::now();
+        const uint64_t done = done_.load(std::memory_order_relaxed);
+        const uint64_t bytes = bytes_.load(std::memory_order_relaxed);
+        const uint64_t total = total_.load(std::memory_order_relaxed);
+        const double elapsed = std::chrono::duration<double>(now - start_).count();
+
+        // EWMA over report intervals with a ~2 s time constant, seeded with the
+        // first observed rate so the ETA is usable right away.
+        const double dt = std::chrono::duration<double>(now - last_).count();
+        if (dt > 0) {
+            const double inst = static_cast<double>(done - last_done_) / dt;
+            const double alpha = 1.0 - std::exp(-dt / 2.0);
+            rate_ = have_rate_ ? rate_ + alpha * (inst - rate_) : inst;
+            have_rate_ = true;
+        }
+        last_ = now;
+        last_done_ = done;
+
+        const double rate = final_line && elapsed > 0 ? done / elapsed : rate_;
+        std::string when = "--:--:--";
+        if (final_line) when = format_secs(elapsed);
+        else if (rate > 0 && total >= done) when = format_secs((total - done) / rate);
+        std::fprintf(out_, "%s%llu/%llu lines (%.1f%%)  %.1f lines/s  %s %s  %.1f MiB written%s",
+                     tty_ ? "\r" : "",
+                     static_cast<unsigned long long>(done), static_cast<unsigned long long>(total),
+                     total ? 100.0 * done / total : 100.0, rate,
+                     final_line ? "elapsed" : "ETA", when.c_str(),
+                     bytes / (1024.0 * 1024.0), (final_line || !tty_) ? "\n" : "\033[K");
+        std::fflush(out_);
+    }
+
+    static std::string format_secs(double s) {
+        char buf[32];
+        const uint64_t secs = static_cast<uint64_t>(s);
+        std::snprintf(buf, sizeof(buf), "%llu:%02llu:%02llu",
+                      static_cast<unsigned long long>(secs / 3600),
+                      static_cast<unsigned long long>(secs / 60 % 60),
+                      static_cast<unsigned long long>(secs % 60));
+        return buf;
+    }
+
+    std::atomic<uint64_t> total_;
+    FILE* const out_;
+    const bool tty_;
+    std::atomic<uint64_t> done_{0};
+    std::atomic<uint64_t> bytes_{0};
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+
+    // Reporter-thread state
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point last_;
+    uint64_t last_done_ = 0;
+    double rate_ = 0.0;
+    bool have_rate_ = false;
+};
+
+#endif  // TIG_PROGRESS_H
@@ -0,0 +1,184 @@
+/*
+ * tig_queue.h - Coordinator-free work queue in a shared directory (--queue DIR)
+ *
+ * Any number of workers, on one host or on machines sharing a filesystem,
+ * split one input into chunks of consecutive lines and take them one at a
+ * time, so a fast worker simply takes more chunks:
+ *   DIR/queue            "lines N chunk C", written once by the first worker
+ *   DIR/chunk-K.claim    created with O_EXCL by the worker rendering chunk K;
+ *                        its mtime is the lease, renewed as lines finish
+ *   DIR/chunk-K.jsonl    manifest records of chunk K
+ *   DIR/chunk-K.done     the claim, renamed once the chunk is complete
+ * A claim not renewed within the lease belongs to a worker that died:
+ * another worker renames it aside (only one rename can win) and claims the
+ * chunk again. Leases compare file mtimes with the local clock, so hosts
+ * sharing a queue need roughly synchronized clocks. Rendering a chunk twice
+ * is harmless, it writes the same files.
+ */
+
+#ifndef TIG_QUEUE_H
+#define TIG_QUEUE_H
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+class TigQueue {
+public:
+    // Joins the queue in dir (created if missing) for an input of lines
+    // renderable lines. The first worker fixes the chunk size; later ones
+    // adopt it and must see the same line count.
+    bool open(const std::string& dir, uint64_t lines, uint64_t chunk_lines, int lease_s, std::string& error) {
+        dir_ = dir;
+        lease_s_ = lease_s;
+        char host[256] = "";
+        gethostname(host, sizeof(host) - 1);
+        token_ = std::string(host) + "-" + std::to_string(getpid());
+        if (mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST) {
+            error = "Could not create queue directory: " + dir;
+            return false;
+        }
+        // Publish the layout with link(), which fails if another worker already did
+        const std::string path = dir_ + "/queue", tmp = path + "." + token_;
+        {
+            std::ofstream out(tmp);
+            out << "lines " << lines << " chunk " << chunk_lines << "\n";
+            if (!out.good()) {
+                error = "Could not write to queue directory: " + dir;
+                return false;
+            }
+        }
+        const bool created = link(tmp.c_str(), path.c_str()) == 0;
+        unlink(tmp.c_str());
+        std::ifstream in(path);
+        std::string lines_key, chunk_key;
+        uint64_t queue_lines = 0;
+        if (!(in >> lines_key >> queue_lines >> chunk_key >> chunk_) || lines_key != "lines" || chunk_key != "chunk" ||
+            chunk_ == 0) {
+            error = "Unreadable queue file: " + path;
+            return false;
+        }
+        if (!created && queue_lines != lines) {
+            error = "Queue " + dir + " was made for an input of " + std::to_string(queue_lines) + " lines, not " +
+                    std::to_string(lines);
+            return false;
+        }
+        chunks_ = (lines + chunk_ - 1) / chunk_;
+        return true;
+    }
+
+    uint64_t chunks() const { return chunks_; }
+    // Chunk k holds the lines with ordinals first_line(k) .. first_line(k) + chunk_size() - 1.
+    uint64_t first_line(uint64_t k) const { return k * chunk_ + 1; }
+    uint64_t chunk_size() const { return chunk_; }
+
+    // Claims the next chunk: an untaken one, else one whose lease expired.
+    // While only live claims of other workers remain, polls so it can take
+    // over if one of them dies. Returns false once every chunk is done.
+    bool claim(uint64_t& chunk) {
+        const auto poll = std::chrono::milliseconds(std::min(5000, std::max(100, lease_s_ * 100)));
+        while (true) {
+            bool waiting = false;
+            for (uint64_t k = first_open_; k < chunks_; ++k) {
+                if (exists(done_path(k))) {
+                    if (k == first_open_) ++first_open_;
+                    continue;
+                }
+                if (create_claim(k) || (stale(claim_path(k)) && reclaim(k))) {
+                    // The owner may have finished between the check and the claim
+                    if (exists(done_path(k))) {
+                        unlink(claim_path(k).c_str());
+                        continue;
+                    }
+                    owned_ = k;
+                    chunk = k;
+                    return true;
+                }
+                waiting = true;
+            }
+            if (!waiting) return false;
+            std::this_thread::sleep_for(poll);
+        }
+    }
+
+    // Renews the lease of the claimed chunk.
+    void renew() const { utimensat(AT_FDCWD, claim_path(owned_).c_str(), nullptr, 0); }
+
+    // Whether the claim is still ours, i.e. no one took it over after the lease expired.
+    bool owned() const {
+        std::ifstream in(claim_path(owned_));
+        std::string token;
+        return std::getline(in, token) && token == token_;
+    }
+
+    // Marks the claimed chunk done.
+    bool complete() { return std::rename(claim_path(owned_).c_str(), done_path(owned_).c_str()) == 0; }
+
+    std::string manifest_path(uint64_t k) const { return dir_ + "/chunk-" + std::to_string(k) + ".jsonl"; }
+
+    // True for exactly one caller per queue (O_EXCL on DIR/name), e.g. to
+    // pick the worker that merges the chunk manifests.
+    bool elect(const std::string& name) const {
+        const int fd = ::open((dir_ + "/" + name).c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+        if (fd < 0) return false;
+        close(fd);
+        return true;
+    }
+
+    uint64_t reclaimed() const { return reclaimed_; }
+
+private:
+    std::string claim_path(uint64_t k) const { return dir_ + "/chunk-" + std::to_string(k) + ".claim"; }
+    std::string done_path(uint64_t k) const { return dir_ + "/chunk-" + std::to_string(k) + ".done"; }
+
+    static bool exists(const std::string& path) {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0;
+    }
+
+    bool stale(const std::string& path) const {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0 && std::time(nullptr) - st.st_mtime > lease_s_;
+    }
+
+    bool create_claim(uint64_t k) const {
+        const int fd = ::open(claim_path(k).c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+        if (fd < 0) return false;
+        const std::string line = token_ + "\n";
+        const bool ok = write(fd, line.data(), line.size()) == static_cast<ssize_t>(line.size());
+        close(fd);
+        return ok;
+    }
+
+    // Moves an expired claim aside and claims the chunk anew. If the claim
+    // moved was renewed meanwhile (another worker reclaimed it first), it is
+    // put back with link(), which never replaces a newer claim.
+    bool reclaim(uint64_t k) {
+        const std::string claim = claim_path(k), aside = claim + ".stale-" + token_;
+        if (std::rename(claim.c_str(), aside.c_str()) != 0) return false;
+        if (!stale(aside)) {
+            link(aside.c_str(), claim.c_str());
+            unlink(aside.c_str());
+            return false;
+        }
+        unlink(aside.c_str());
+        if (!create_claim(k)) return false;
+        ++reclaimed_;
+        return true;
+    }
+
+    std::string dir_, token_;
+    int lease_s_ = 300;
+    uint64_t chunk_ = 1, chunks_ = 0, first_open_ = 0, owned_ = 0, reclaimed_ = 0;
+};
+
+#endif  // TIG_QUEUE_H
@@ -0,0 +1,157 @@
+/*
+ * tig_schedule.h - Longest-first scheduling of independent lines (--jobs)
+ *
+ * Taken in input order, one long line that starts last keeps a single core
+ * busy after all the others ran dry. Dispatching in decreasing estimated
+ * cost instead (LPT list scheduling) bounds the batch time at 4/3 of the
+ * optimum. Workers pull from one shared cursor over the sorted order: a
+ * worker that finishes early takes the most expensive line left, so load
+ * evens out without per-worker queues. Only execution order changes, every
+ * line keeps its own number.
+ *
+ * With a TigConcurrency controller (--jobs auto) only the first target()
+ * workers take lines; the others wait until the controller raises the
+ * target again.
+ */
+
+#ifndef TIG_SCHEDULE_H
+#define TIG_SCHEDULE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "tig_cgroup.h"
+#include "tig_parallel.h"
+
+// Worker count for --jobs auto. Starts at the CPU budget and is re-evaluated
+// about once a second from the work finished in that window:
+//  - memory.current above 90% of memory.max, or the cgroup throttled for
+//    over a tenth of the window: one worker fewer;
+//  - otherwise one more worker is tried (up to max, with memory below 80%)
+//    and kept only if throughput, in estimated cost per second, rose by 2%;
+//    a rejected or forced step holds the count for a few windows.
+class TigConcurrency {
+public:
+    TigConcurrency(unsigned start, unsigned max)
+        : max_(std::max(1u, max)), target_(std::min(std::max(1u, start), max_)), start_(target_),
+          lowest_(target_), highest_(target_) {}
+
+    unsigned target() const { return target_.load(std::memory_order_relaxed); }
+    unsigned max() const { return max_; }
+    unsigned start() const { return start_; }
+    unsigned lowest() const { return lowest_; }
+    unsigned highest() const { return highest_; }
+    unsigned changes() const { return changes_; }
+
+    // Called by a worker after each line with its estimated cost.
+    void done(double cost) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto now = std::chrono::steady_clock::now();
+        if (window_cost_ < 0) {  // first line: start the first window
+            window_start_ = now;
+            throttled_start_ = tig_cgroup_throttled_usec();
+            window_cost_ = 0;
+        }
+        window_cost_ += cost;
+        const double secs = std::chrono::duration<double>(now - window_start_).count();
+        if (secs < 1.0) return;
+        const uint64_t memory_max = tig_cgroup().memory_max;
+        const double memory = memory_max ? static_cast<double>(tig_cgroup_memory_current()) / memory_max : 0.0;
+        const uint64_t throttled = tig_cgroup_throttled_usec();
+        adjust(window_cost_ / secs, memory, (throttled - throttled_start_) / (secs * 1e6));
+        window_start_ = now;
+        throttled_start_ = throttled;
+        window_cost_ = 0;
+    }
+
+    // One decision from a window's throughput, memory use (fraction of
+    // memory.max) and throttled fraction of the window.
+    void adjust(double rate, double memory, double throttled) {
+        const unsigned t = target();
+        int step = 0;
+        if ((memory > 0.9 || throttled > 0.1) && t > 1) {
+            step = -1;
+            hold_ = 3;
+        } else if (last_step_ > 0 && rate < last_rate_ * 1.02) {
+            step = -1;  // the extra worker did not pay off
+            hold_ = 5;
+        } else if (hold_ > 0) {
+            --hold_;
+        } else if (t < max_ && memory < 0.8) {
+            step = 1;
+        }
+        last_rate_ = rate;
+        last_step_ = step;
+        if (step == 0) return;
+        const unsigned next = t + step;
+        target_.store(next, std::memory_order_relaxed);
+        lowest_ = std::min(lowest_, next);
+        highest_ = std::max(highest_, next);
+        ++changes_;
+    }
+
+private:
+    const unsigned max_;
+    std::atomic<unsigned> target_;
+    unsigned start_, lowest_, highest_, changes_ = 0;
+    std::mutex mutex_;
+    std::chrono::steady_clock::time_point window_start_;
+    uint64_t throttled_start_ = 0;
+    double window_cost_ = -1.0;
+    double last_rate_ = 0.0;
+    int last_step_ = 0;
+    int hold_ = 0;
+};
+
+// Calls fn(i) for every i in [0, costs.size()) on up to workers threads (the
+// caller is one of them), most expensive first unless longest_first is
+// false. fn returns false to stop the batch; tasks already running finish.
+// With control, up to control->max() threads run, control->target() at a time.
+template <typename Fn>
+inline void tig_run_scheduled(const std::vector<double>& costs, bool longest_first, unsigned workers, Fn fn,
+                              TigConcurrency* control = nullptr) {
+    std::vector<size_t> order(costs.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    if (longest_first) {
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return costs[a] > costs[b]; });
+    }
+    std::atomic<size_t> next(0);
+    std::atomic<bool> stop(false);
+    auto work = [&](unsigned worker) {
+        const bool was_inline = tig_parallel_inline();
+        tig_parallel_inline() = true;
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (control && worker >= control->target()) {
+                if (next.load(std::memory_order_relaxed) >= order.size()) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                continue;
+            }
+            const size_t k = next.fetch_add(1);
+            if (k >= order.size()) break;
+            if (!fn(order[k])) stop = true;
+            if (control) control->done(costs[order[k]]);
+        }
+        tig_parallel_inline() = was_inline;
+    };
+    if (control) workers = control->max();
+    const unsigned threads = static_cast<unsigned>(std::min<size_t>(std::max(1u, workers), order.size()));
+    if (threads <= 1) {
+        for (size_t i : order) {
+            if (!fn(i)) break;
+        }
+        return;
+    }
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(work, t);
+    work(0);
+    for (std::thread& t : pool) t.join();
+}
+
+#endif  // TIG_SCHEDULE_H
@@ -0,0 +1,75 @@
+/*
+ * tig_shard.h - Static split of one input across render nodes (--shard I/N)
+ *
+ * Every node reads the whole input and renders only its share of the lines,
+ * so output names keep their global line numbers. Lines are counted by
+ * ordinal (1 = first line the tool would render, blank lines never count)
+ * and dealt out round-robin (ordinal k goes to shard (k - 1) % N + 1) or in
+ * contiguous blocks of ceil(total / N). Each node writes a partial manifest;
+ * tig_manifest_merge() combines them.
+ */
+
+#ifndef TIG_SHARD_H
+#define TIG_SHARD_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+struct TigShard {
+    int index = 1;  // 1-based
+    int count = 1;  // 1 = no sharding
+    bool contiguous = false;
+    uint64_t block = 0;  // contiguous block length, from tig_shard_plan()
+};
+
+// Parses "I/N" with 1 <= I <= N.
+inline bool tig_shard_parse(const std::string& spec, TigShard& out) {
+    const char* p = spec.c_str();
+    char* end = nullptr;
+    const long index = std::strtol(p, &end, 10);
+    if (end == p || *end != '/') return false;
+    p = end + 1;
+    const long count = std::strtol(p, &end, 10);
+    if (end == p || *end != '\0' || count < 1 || count > 1000000 || index < 1 || index > count) return false;
+    out.index = static_cast<int>(index);
+    out.count = static_cast<int>(count);
+    return true;
+}
+
+// "round-robin" or "contiguous".
+inline bool tig_shard_set_mode(const std::string& mode, TigShard& out) {
+    if (mode == "round-robin") out.contiguous = false;
+    else if (mode == "contiguous") out.contiguous = true;
+    else return false;
+    return true;
+}
+
+// Sizes contiguous blocks for an input of total renderable lines.
+inline void tig_shard_plan(TigShard& shard, uint64_t total) {
+    shard.block = (total + shard.count - 1) / shard.count;
+}
+
+// Whether the line with this 1-based ordinal belongs to the shard.
+inline bool tig_shard_owns(const TigShard& shard, uint64_t ordinal) {
+    if (shard.count <= 1) return true;
+    if (shard.contiguous) return shard.block > 0 && (ordinal - 1) / shard.block == static_cast<uint64_t>(shard.index - 1);
+    return (ordinal - 1) % shard.count == static_cast<uint64_t>(shard.index - 1);
+}
+
+// How many of total lines the shard renders.
+inline uint64_t tig_shard_share(const TigShard& shard, uint64_t total) {
+    if (shard.count <= 1) return total;
+    const uint64_t first = shard.contiguous ? shard.block * (shard.index - 1) : static_cast<uint64_t>(shard.index - 1);
+    if (first >= total) return 0;
+    if (shard.contiguous) return std::min<uint64_t>(shard.block, total - first);
+    return (total - first + shard.count - 1) / shard.count;
+}
+
+// Default partial manifest name: <prefix>manifest-shard-<I>of<N>.jsonl
+inline std::string tig_shard_manifest_name(const std::string& prefix, const TigShard& shard) {
+    return prefix + "manifest-shard-" + std::to_string(shard.index) + "of" + std::to_string(shard.count) + ".jsonl";
+}
+
+#endif  // TIG_SHARD_H
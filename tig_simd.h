@@ -0,0 +1,719 @@
+/*
+ * tig_simd.h - Runtime CPU dispatch for pixel kernels
+ *
+ * One binary runs on SSE4, AVX2 and AVX-512 hosts: every kernel is compiled
+ * once per instruction set (GCC/Clang target attributes) and tig_simd_select()
+ * fills the kernel table at startup from cpuid, or from a --simd override
+ * (auto|scalar|sse4|avx2|avx512) for testing and benchmarking a single path.
+ * Callers always go through tig_kernels().
+ *
+ * All variants of a kernel produce bit-identical output.
+ */
+
+#ifndef TIG_SIMD_H
+#define TIG_SIMD_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TIG_SIMD_X86 1
+#endif
+
+enum TigSimdLevel {
+    TIG_SIMD_SCALAR = 0,
+    TIG_SIMD_SSE4,
+    TIG_SIMD_AVX2,
+    TIG_SIMD_AVX512,
+};
+
+struct TigKernels {
+    TigSimdLevel level;
+
+    // cairo ARGB32 (native-endian, premultiplied) -> straight-alpha RGBA bytes,
+    // using cairo's own rounding: c = (c * 255 + a / 2) / a.
+    void (*argb32_to_rgba)(const uint32_t* src, uint8_t* dst, size_t n);
+
+    // delta[i] = |a[i] - b[i]|; returns how many bytes exceed tol.
+    size_t (*absdiff_count)(const uint8_t* a, const uint8_t* b, uint8_t* delta, size_t n, uint8_t tol);
+
+    // Premultiplied opacity scaling: every byte c -> (c * factor + 128) >> 8,
+    // factor 0-256 (256 copies). dst may equal src.
+    void (*scale_argb32)(const uint32_t* src, uint32_t* dst, size_t n, uint32_t factor);
+
+    // Index of the first pixel where a and b differ (n if none); *end is set
+    // one past the last differing pixel (0 if none).
+    size_t (*diff_span)(const uint32_t* a, const uint32_t* b, size_t n, size_t* end);
+
+    // Premultiplied "over": dst = src + dst * (255 - src alpha) / 255 per
+    // byte, the division rounded to nearest.
+    void (*over_argb32)(const uint32_t* src, uint32_t* dst, size_t n);
+
+    // One row of a running box sum down columns: out = (sums * mul + 2^23) >> 24,
+    // then sums += add - sub. mul is 2^24 / box size (sums * mul < 2^32).
+    void (*box_step)(uint32_t* sums, const uint8_t* add, const uint8_t* sub, uint8_t* out, size_t n, uint32_t mul);
+
+    // over_argb32 on 16-bit channels (4 x uint16 per pixel, alpha in the top
+    // one): dst = src + dst * (65535 - src alpha) / 65535, rounded to nearest.
+    // Used for linear-light blending.
+    void (*over_rgba64)(const uint64_t* src, uint64_t* dst, size_t n);
+};
+
+inline const char* tig_simd_name(TigSimdLevel level) {
+    switch (level) {
+        case TIG_SIMD_SSE4: return "sse4";
+        case TIG_SIMD_AVX2: return "avx2";
+        case TIG_SIMD_AVX512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Scalar reference kernels
+// ---------------------------------------------------------------------------
+
+inline void tig_argb32_to_rgba_scalar(const uint32_t* src, uint8_t* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i, dst += 4) {
+        uint32_t px = src[i];
+        uint32_t a = px >> 24;
+        if (a == 0) {
+            dst[0] = dst[1] = dst[2] = dst[3] = 0;
+            continue;
+        }
+        dst[0] = static_cast<uint8_t>((((px >> 16) & 0xFF) * 255 + a / 2) / a);
+        dst[1] = static_cast<uint8_t>((((px >> 8) & 0xFF) * 255 + a / 2) / a);
+        dst[2] = static_cast<uint8_t>(((px & 0xFF) * 255 + a / 2) / a);
+        dst[3] = static_cast<uint8_t>(a);
+    }
+}
+
+inline size_t tig_absdiff_count_scalar(const uint8_t* a, const uint8_t* b, uint8_t* delta, size_t n, uint8_t tol) {
+    size_t over = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t d = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+        delta[i] = d;
+        over += d > tol;
+    }
+    return over;
+}
+
+inline void tig_scale_argb32_scalar(const uint32_t* src, uint32_t* dst, size_t n, uint32_t factor) {
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t px = src[i], out = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            out |= ((((px >> shift) & 0xFF) * factor + 128) >> 8) << shift;
+        }
+        dst[i] = out;
+    }
+}
+
+inline size_t tig_diff_span_scalar(const uint32_t* a, const uint32_t* b, size_t n, size_t* end) {
+    size_t first = 0;
+    while (first < n && a[first] == b[first]) ++first;
+    size_t last = n;
+    while (last > first && a[last - 1] == b[last - 1]) --last;
+    *end = first < n ? last : 0;
+    return first;
+}
+
+// x / 255 rounded to nearest, exact for x <= 255 * 255
+inline uint32_t tig_div255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+inline void tig_over_argb32_scalar(const uint32_t* src, uint32_t* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        const uint32_t s = src[i];
+        if (s == 0) continue;
+        const uint32_t ia = 255 - (s >> 24), d = dst[i];
+        uint32_t out = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            const uint32_t c = ((s >> shift) & 0xFF) + tig_div255(((d >> shift) & 0xFF) * ia);
+            out |= std::min<uint32_t>(c, 255) << shift;
+        }
+        dst[i] = out;
+    }
+}
+
+// x / 65535 rounded to nearest, exact for x <= 65535 * 65535
+inline uint32_t tig_div65535(uint32_t x) {
+    x += 32768;
+    return (x + (x >> 16)) >> 16;
+}
+
+inline void tig_over_rgba64_scalar(const uint64_t* src, uint64_t* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t s = src[i];
+        if (s == 0) continue;
+        const uint32_t ia = 65535 - static_cast<uint32_t>(s >> 48);
+        const uint64_t d = dst[i];
+        uint64_t out = 0;
+        for (int shift = 0; shift < 64; shift += 16) {
+            const uint32_t c = static_cast<uint32_t>((s >> shift) & 0xFFFF) +
+                               tig_div65535(static_cast<uint32_t>((d >> shift) & 0xFFFF) * ia);
+            out |= static_cast<uint64_t>(std::min<uint32_t>(c, 65535)) << shift;
+        }
+        dst[i] = out;
+    }
+}
+
+inline void tig_box_step_scalar(uint32_t* sums, const uint8_t* add, const uint8_t* sub, uint8_t* out, size_t n,
+                                uint32_t mul) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = static_cast<uint8_t>((sums[i] * mul + (1u << 23)) >> 24);
+        sums[i] += static_cast<uint32_t>(add[i]) - sub[i];
+    }
+}
+
+#ifdef TIG_SIMD_X86
+
+// Unpremultiply runs in float: numerators are < 2^17 and divisors <= 255, so a
+// correctly rounded quotient can never cross an integer boundary and the
+// truncation matches the integer formula exactly. Results are masked to 8 bits
+// like the scalar byte store, so even invalid (c > a) input matches.
+
+// ---------------------------------------------------------------------------
+// SSE4.1
+// ---------------------------------------------------------------------------
+
+__attribute__((target("sse4.1")))
+inline __m128i tig_unpremul_sse4(__m128i c, __m128i a, __m128 af, __m128i zero_mask) {
+    __m128i num = _mm_add_epi32(_mm_mullo_epi32(c, _mm_set1_epi32(255)), _mm_srli_epi32(a, 1));
+    __m128i q = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(num), af));
+    return _mm_and_si128(_mm_andnot_si128(zero_mask, q), _mm_set1_epi32(0xFF));
+}
+
+__attribute__((target("sse4.1")))
+inline void tig_argb32_to_rgba_sse4(const uint32_t* src, uint8_t* dst, size_t n) {
+    const __m128i ff = _mm_set1_epi32(0xFF);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i a = _mm_srli_epi32(px, 24);
+        __m128i zero = _mm_cmpeq_epi32(a, _mm_setzero_si128());
+        __m128 af = _mm_cvtepi32_ps(a);
+        __m128i r = tig_unpremul_sse4(_mm_and_si128(_mm_srli_epi32(px, 16), ff), a, af, zero);
+        __m128i g = tig_unpremul_sse4(_mm_and_si128(_mm_srli_epi32(px, 8), ff), a, af, zero);
+        __m128i b = tig_unpremul_sse4(_mm_and_si128(px, ff), a, af, zero);
+        __m128i out = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+                                   _mm_or_si128(_mm_slli_epi32(b, 16), _mm_slli_epi32(a, 24)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i), out);
+    }
+    tig_argb32_to_rgba_scalar(src + i, dst + 4 * i, n - i);
+}
+
+inline size_t tig_absdiff_count_sse2(const uint8_t* a, const uint8_t* b, uint8_t* delta, size_t n, uint8_t tol) {
+    const __m128i vtol = _mm_set1_epi8(static_cast<char>(tol));
+    size_t over = 0, i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(delta + i), d);
+        // d > tol  <=>  saturating (d - tol) != 0
+        __m128i le = _mm_cmpeq_epi8(_mm_subs_epu8(d, vtol), _mm_setzero_si128());
+        over += 16 - static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(_mm_movemask_epi8(le))));
+    }
+    return over + tig_absdiff_count_scalar(a + i, b + i, delta + i, n - i, tol);
+}
+
+// Bytes widened to 16 bits: c * factor + 128 <= 65408 cannot overflow.
+inline void tig_scale_argb32_sse2(const uint32_t* src, uint32_t* dst, size_t n, uint32_t factor) {
+    const __m128i f = _mm_set1_epi16(static_cast<short>(factor));
+    const __m128i half = _mm_set1_epi16(128);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(px, zero), f), half), 8);
+        __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(px, zero), f), half), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    tig_scale_argb32_scalar(src + i, dst + i, n - i, factor);
+}
+
+// Whole vectors are skipped from both ends; the scalar loop resolves the
+// pixel inside the first/last differing vector.
+inline size_t tig_diff_span_sse2(const uint32_t* a, const uint32_t* b, size_t n, size_t* end) {
+    size_t first = 0;
+    while (first + 4 <= n &&
+           _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + first)),
+                                             _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + first)))) == 0xFFFF) {
+        first += 4;
+    }
+    size_t last = n;
+    while (last >= first + 4 &&
+           _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + last - 4)),
+                                             _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + last - 4)))) == 0xFFFF) {
+        last -= 4;
+    }
+    size_t tail_end;
+    const size_t head = tig_diff_span_scalar(a + first, b + first, last - first, &tail_end);
+    *end = tail_end ? first + tail_end : 0;
+    return first + head;
+}
+
+// 16-bit lanes hold one channel each; the alpha lane (3 of every 4) is
+// broadcast with shufflelo/hi. Vectors of fully transparent source pixels are
+// skipped, which is most of a text layer.
+inline __m128i tig_over_half_sse2(__m128i s, __m128i d) {
+    const __m128i ia = _mm_sub_epi16(_mm_set1_epi16(255), _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xFF), 0xFF));
+    __m128i x = _mm_add_epi16(_mm_mullo_epi16(d, ia), _mm_set1_epi16(128));
+    x = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    return _mm_add_epi16(s, x);
+}
+
+inline void tig_over_argb32_sse2(const uint32_t* src, uint32_t* dst, size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xFFFF) continue;
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i lo = tig_over_half_sse2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+        __m128i hi = tig_over_half_sse2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    tig_over_argb32_scalar(src + i, dst + i, n - i);
+}
+
+// Four sums per vector; the 16 results are packed back to bytes with
+// saturation, which never triggers for valid sums.
+__attribute__((target("sse4.1")))
+inline __m128i tig_box_quad_sse4(uint32_t* sums, __m128i add, __m128i sub, __m128i m) {
+    __m128i sv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums));
+    __m128i q = _mm_srli_epi32(_mm_add_epi32(_mm_mullo_epi32(sv, m), _mm_set1_epi32(1 << 23)), 24);
+    sv = _mm_add_epi32(sv, _mm_sub_epi32(_mm_cvtepu8_epi32(add), _mm_cvtepu8_epi32(sub)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), sv);
+    return q;
+}
+
+__attribute__((target("sse4.1")))
+inline void tig_box_step_sse4(uint32_t* sums, const uint8_t* add, const uint8_t* sub, uint8_t* out, size_t n,
+                              uint32_t mul) {
+    const __m128i m = _mm_set1_epi32(static_cast<int>(mul));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(add + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sub + i));
+        const __m128i q0 = tig_box_quad_sse4(sums + i, a, b, m);
+        const __m128i q1 = tig_box_quad_sse4(sums + i + 4, _mm_srli_si128(a, 4), _mm_srli_si128(b, 4), m);
+        const __m128i q2 = tig_box_quad_sse4(sums + i + 8, _mm_srli_si128(a, 8), _mm_srli_si128(b, 8), m);
+        const __m128i q3 = tig_box_quad_sse4(sums + i + 12, _mm_srli_si128(a, 12), _mm_srli_si128(b, 12), m);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         _mm_packus_epi16(_mm_packus_epi32(q0, q1), _mm_packus_epi32(q2, q3)));
+    }
+    tig_box_step_scalar(sums + i, add + i, sub + i, out + i, n - i, mul);
+}
+
+// 16-bit over, one pixel per four 32-bit lanes. The product fits in 32 bits
+// unsigned, so mullo_epi32 and logical shifts give the scalar result; the
+// final pack saturates like the scalar min().
+__attribute__((target("sse4.1")))
+inline __m128i tig_over_px64_sse4(__m128i s, __m128i d) {
+    const __m128i ia = _mm_sub_epi32(_mm_set1_epi32(65535), _mm_shuffle_epi32(s, 0xFF));
+    __m128i x = _mm_add_epi32(_mm_mullo_epi32(d, ia), _mm_set1_epi32(32768));
+    x = _mm_srli_epi32(_mm_add_epi32(x, _mm_srli_epi32(x, 16)), 16);
+    return _mm_add_epi32(s, x);
+}
+
+__attribute__((target("sse4.1")))
+inline void tig_over_rgba64_sse4(const uint64_t* src, uint64_t* dst, size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (_mm_testz_si128(s, s)) continue;
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i lo = tig_over_px64_sse4(_mm_cvtepu16_epi32(s), _mm_cvtepu16_epi32(d));
+        __m128i hi = tig_over_px64_sse4(_mm_unpackhi_epi16(s, zero), _mm_unpackhi_epi16(d, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi32(lo, hi));
+    }
+    tig_over_rgba64_scalar(src + i, dst + i, n - i);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2
+// ---------------------------------------------------------------------------
+
+__attribute__((target("avx2")))
+inline __m256i tig_unpremul_avx2(__m256i c, __m256i a, __m256 af, __m256i zero_mask) {
+    __m256i num = _mm256_add_epi32(_mm256_mullo_epi32(c, _mm256_set1_epi32(255)), _mm256_srli_epi32(a, 1));
+    __m256i q = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(num), af));
+    return _mm256_and_si256(_mm256_andnot_si256(zero_mask, q), _mm256_set1_epi32(0xFF));
+}
+
+__attribute__((target("avx2")))
+inline void tig_argb32_to_rgba_avx2(const uint32_t* src, uint8_t* dst, size_t n) {
+    const __m256i ff = _mm256_set1_epi32(0xFF);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i a = _mm256_srli_epi32(px, 24);
+        __m256i zero = _mm256_cmpeq_epi32(a, _mm256_setzero_si256());
+        __m256 af = _mm256_cvtepi32_ps(a);
+        __m256i r = tig_unpremul_avx2(_mm256_and_si256(_mm256_srli_epi32(px, 16), ff), a, af, zero);
+        __m256i g = tig_unpremul_avx2(_mm256_and_si256(_mm256_srli_epi32(px, 8), ff), a, af, zero);
+        __m256i b = tig_unpremul_avx2(_mm256_and_si256(px, ff), a, af, zero);
+        __m256i out = _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)),
+                                      _mm256_or_si256(_mm256_slli_epi32(b, 16), _mm256_slli_epi32(a, 24)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * i), out);
+    }
+    tig_argb32_to_rgba_sse4(src + i, dst + 4 * i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline size_t tig_absdiff_count_avx2(const uint8_t* a, const uint8_t* b, uint8_t* delta, size_t n, uint8_t tol) {
+    const __m256i vtol = _mm256_set1_epi8(static_cast<char>(tol));
+    size_t over = 0, i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i d = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(delta + i), d);
+        __m256i le = _mm256_cmpeq_epi8(_mm256_subs_epu8(d, vtol), _mm256_setzero_si256());
+        over += 32 - static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(_mm256_movemask_epi8(le))));
+    }
+    return over + tig_absdiff_count_sse2(a + i, b + i, delta + i, n - i, tol);
+}
+
+// unpack/pack work per 128-bit lane, so the byte order round-trips.
+__attribute__((target("avx2")))
+inline void tig_scale_argb32_avx2(const uint32_t* src, uint32_t* dst, size_t n, uint32_t factor) {
+    const __m256i f = _mm256_set1_epi16(static_cast<short>(factor));
+    const __m256i half = _mm256_set1_epi16(128);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(px, zero), f), half), 8);
+        __m256i hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(px, zero), f), half), 8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+    tig_scale_argb32_sse2(src + i, dst + i, n - i, factor);
+}
+
+__attribute__((target("avx2")))
+inline size_t tig_diff_span_avx2(const uint32_t* a, const uint32_t* b, size_t n, size_t* end) {
+    size_t first = 0;
+    while (first + 8 <= n &&
+           _mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + first)),
+                                                   _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + first)))) == -1) {
+        first += 8;
+    }
+    size_t last = n;
+    while (last >= first + 8 &&
+           _mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + last - 8)),
+                                                   _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + last - 8)))) == -1) {
+        last -= 8;
+    }
+    size_t tail_end;
+    const size_t head = tig_diff_span_sse2(a + first, b + first, last - first, &tail_end);
+    *end = tail_end ? first + tail_end : 0;
+    return first + head;
+}
+
+__attribute__((target("avx2")))
+inline __m256i tig_over_half_avx2(__m256i s, __m256i d) {
+    const __m256i ia = _mm256_sub_epi16(_mm256_set1_epi16(255),
+                                        _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xFF), 0xFF));
+    __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(d, ia), _mm256_set1_epi16(128));
+    x = _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+    return _mm256_add_epi16(s, x);
+}
+
+__attribute__((target("avx2")))
+inline void tig_over_argb32_avx2(const uint32_t* src, uint32_t* dst, size_t n) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        if (_mm256_testz_si256(s, s)) continue;
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i lo = tig_over_half_avx2(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero));
+        __m256i hi = tig_over_half_avx2(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+    tig_over_argb32_sse2(src + i, dst + i, n - i);
+}
+
+// Two pixels per vector; packus_epi32 works per 128-bit lane, so the packed
+// quadwords come out as 0, 2, 1, 3 and are permuted back.
+__attribute__((target("avx2")))
+inline __m256i tig_over_px64_avx2(__m256i s, __m256i d) {
+    const __m256i ia = _mm256_sub_epi32(_mm256_set1_epi32(65535), _mm256_shuffle_epi32(s, 0xFF));
+    __m256i x = _mm256_add_epi32(_mm256_mullo_epi32(d, ia), _mm256_set1_epi32(32768));
+    x = _mm256_srli_epi32(_mm256_add_epi32(x, _mm256_srli_epi32(x, 16)), 16);
+    return _mm256_add_epi32(s, x);
+}
+
+__attribute__((target("avx2")))
+inline void tig_over_rgba64_avx2(const uint64_t* src, uint64_t* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        if (_mm256_testz_si256(s, s)) continue;
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i lo = tig_over_px64_avx2(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(s)),
+                                        _mm256_cvtepu16_epi32(_mm256_castsi256_si128(d)));
+        __m256i hi = tig_over_px64_avx2(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(s, 1)),
+                                        _mm256_cvtepu16_epi32(_mm256_extracti128_si256(d, 1)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                            _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8));
+    }
+    tig_over_rgba64_sse4(src + i, dst + i, n - i);
+}
+
+// Eight sums per vector; the low byte of each is gathered into the first
+// eight bytes (per-lane shuffle, then a cross-lane dword permute).
+__attribute__((target("avx2")))
+inline void tig_box_step_avx2(uint32_t* sums, const uint8_t* add, const uint8_t* sub, uint8_t* out, size_t n,
+                              uint32_t mul) {
+    const __m256i m = _mm256_set1_epi32(static_cast<int>(mul));
+    const __m256i half = _mm256_set1_epi32(1 << 23);
+    const __m256i low_bytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                               0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i gather = _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i sv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sums + i));
+        __m256i q = _mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(sv, m), half), 24);
+        q = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(q, low_bytes), gather);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm256_castsi256_si128(q));
+        const __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(add + i)));
+        const __m256i b = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(sub + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums + i), _mm256_add_epi32(sv, _mm256_sub_epi32(a, b)));
+    }
+    tig_box_step_sse4(sums + i, add + i, sub + i, out + i, n - i, mul);
+}
+
+// ---------------------------------------------------------------------------
+// AVX-512 (F + BW)
+// ---------------------------------------------------------------------------
+
+// GCC 12 warns spuriously about _mm512_undefined_*() inside the intrinsics.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+__attribute__((target("avx512f,avx512bw")))
+inline __m512i tig_unpremul_avx512(__m512i c, __m512i a, __m512 af, __mmask16 nonzero) {
+    __m512i num = _mm512_add_epi32(_mm512_mullo_epi32(c, _mm512_set1_epi32(255)), _mm512_srli_epi32(a, 1));
+    __m512i q = _mm512_cvttps_epi32(_mm512_div_ps(_mm512_cvtepi32_ps(num), af));
+    return _mm512_maskz_and_epi32(nonzero, q, _mm512_set1_epi32(0xFF));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline void tig_argb32_to_rgba_avx512(const uint32_t* src, uint8_t* dst, size_t n) {
+    const __m512i ff = _mm512_set1_epi32(0xFF);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i px = _mm512_loadu_si512(src + i);
+        __m512i a = _mm512_srli_epi32(px, 24);
+        __mmask16 nonzero = _mm512_test_epi32_mask(a, a);
+        __m512 af = _mm512_cvtepi32_ps(a);
+        __m512i r = tig_unpremul_avx512(_mm512_and_si512(_mm512_srli_epi32(px, 16), ff), a, af, nonzero);
+        __m512i g = tig_unpremul_avx512(_mm512_and_si512(_mm512_srli_epi32(px, 8), ff), a, af, nonzero);
+        __m512i b = tig_unpremul_avx512(_mm512_and_si512(px, ff), a, af, nonzero);
+        __m512i out = _mm512_or_si512(_mm512_or_si512(r, _mm512_slli_epi32(g, 8)),
+                                      _mm512_or_si512(_mm512_slli_epi32(b, 16), _mm512_slli_epi32(a, 24)));
+        _mm512_storeu_si512(dst + 4 * i, out);
+    }
+    tig_argb32_to_rgba_avx2(src + i, dst + 4 * i, n - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline size_t tig_absdiff_count_avx512(const uint8_t* a, const uint8_t* b, uint8_t* delta, size_t n, uint8_t tol) {
+    const __m512i vtol = _mm512_set1_epi8(static_cast<char>(tol));
+    size_t over = 0, i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i va = _mm512_loadu_si512(a + i);
+        __m512i vb = _mm512_loadu_si512(b + i);
+        __m512i d = _mm512_or_si512(_mm512_subs_epu8(va, vb), _mm512_subs_epu8(vb, va));
+        _mm512_storeu_si512(delta + i, d);
+        over += static_cast<size_t>(__builtin_popcountll(_mm512_cmpgt_epu8_mask(d, vtol)));
+    }
+    return over + tig_absdiff_count_avx2(a + i, b + i, delta + i, n - i, tol);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline void tig_scale_argb32_avx512(const uint32_t* src, uint32_t* dst, size_t n, uint32_t factor) {
+    const __m512i f = _mm512_set1_epi16(static_cast<short>(factor));
+    const __m512i half = _mm512_set1_epi16(128);
+    const __m512i zero = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i px = _mm512_loadu_si512(src + i);
+        __m512i lo = _mm512_srli_epi16(_mm512_add_epi16(_mm512_mullo_epi16(_mm512_unpacklo_epi8(px, zero), f), half), 8);
+        __m512i hi = _mm512_srli_epi16(_mm512_add_epi16(_mm512_mullo_epi16(_mm512_unpackhi_epi8(px, zero), f), half), 8);
+        _mm512_storeu_si512(dst + i, _mm512_packus_epi16(lo, hi));
+    }
+    tig_scale_argb32_avx2(src + i, dst + i, n - i, factor);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline size_t tig_diff_span_avx512(const uint32_t* a, const uint32_t* b, size_t n, size_t* end) {
+    size_t first = 0;
+    while (first + 16 <= n && _mm512_cmpneq_epu32_mask(_mm512_loadu_si512(a + first), _mm512_loadu_si512(b + first)) == 0) {
+        first += 16;
+    }
+    size_t last = n;
+    while (last >= first + 16 &&
+           _mm512_cmpneq_epu32_mask(_mm512_loadu_si512(a + last - 16), _mm512_loadu_si512(b + last - 16)) == 0) {
+        last -= 16;
+    }
+    size_t tail_end;
+    const size_t head = tig_diff_span_avx2(a + first, b + first, last - first, &tail_end);
+    *end = tail_end ? first + tail_end : 0;
+    return first + head;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline __m512i tig_over_half_avx512(__m512i s, __m512i d) {
+    const __m512i ia = _mm512_sub_epi16(_mm512_set1_epi16(255),
+                                        _mm512_shufflehi_epi16(_mm512_shufflelo_epi16(s, 0xFF), 0xFF));
+    __m512i x = _mm512_add_epi16(_mm512_mullo_epi16(d, ia), _mm512_set1_epi16(128));
+    x = _mm512_srli_epi16(_mm512_add_epi16(x, _mm512_srli_epi16(x, 8)), 8);
+    return _mm512_add_epi16(s, x);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline void tig_over_argb32_avx512(const uint32_t* src, uint32_t* dst, size_t n) {
+    const __m512i zero = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i s = _mm512_loadu_si512(src + i);
+        if (_mm512_test_epi32_mask(s, s) == 0) continue;
+        __m512i d = _mm512_loadu_si512(dst + i);
+        __m512i lo = tig_over_half_avx512(_mm512_unpacklo_epi8(s, zero), _mm512_unpacklo_epi8(d, zero));
+        __m512i hi = tig_over_half_avx512(_mm512_unpackhi_epi8(s, zero), _mm512_unpackhi_epi8(d, zero));
+        _mm512_storeu_si512(dst + i, _mm512_packus_epi16(lo, hi));
+    }
+    tig_over_argb32_avx2(src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline void tig_box_step_avx512(uint32_t* sums, const uint8_t* add, const uint8_t* sub, uint8_t* out, size_t n,
+                                uint32_t mul) {
+    const __m512i m = _mm512_set1_epi32(static_cast<int>(mul));
+    const __m512i half = _mm512_set1_epi32(1 << 23);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i sv = _mm512_loadu_si512(sums + i);
+        const __m512i q = _mm512_srli_epi32(_mm512_add_epi32(_mm512_mullo_epi32(sv, m), half), 24);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm512_cvtepi32_epi8(q));
+        const __m512i a = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(add + i)));
+        const __m512i b = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(sub + i)));
+        _mm512_storeu_si512(sums + i, _mm512_add_epi32(sv, _mm512_sub_epi32(a, b)));
+    }
+    tig_box_step_avx2(sums + i, add + i, sub + i, out + i, n - i, mul);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline __m512i tig_over_px64_avx512(__m512i s, __m512i d) {
+    const __m512i ia = _mm512_sub_epi32(_mm512_set1_epi32(65535), _mm512_shuffle_epi32(s, _MM_PERM_DDDD));
+    __m512i x = _mm512_add_epi32(_mm512_mullo_epi32(d, ia), _mm512_set1_epi32(32768));
+    x = _mm512_srli_epi32(_mm512_add_epi32(x, _mm512_srli_epi32(x, 16)), 16);
+    return _mm512_add_epi32(s, x);
+}
+
+// Four pixels per half; cvtusepi32_epi16 narrows with the same saturation.
+__attribute__((target("avx512f,avx512bw")))
+inline void tig_over_rgba64_avx512(const uint64_t* src, uint64_t* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512i s = _mm512_loadu_si512(src + i);
+        if (_mm512_test_epi64_mask(s, s) == 0) continue;
+        __m512i d = _mm512_loadu_si512(dst + i);
+        __m512i lo = tig_over_px64_avx512(_mm512_cvtepu16_epi32(_mm512_castsi512_si256(s)),
+                                          _mm512_cvtepu16_epi32(_mm512_castsi512_si256(d)));
+        __m512i hi = tig_over_px64_avx512(_mm512_cvtepu16_epi32(_mm512_extracti64x4_epi64(s, 1)),
+                                          _mm512_cvtepu16_epi32(_mm512_extracti64x4_epi64(d, 1)));
+        _mm512_storeu_si512(dst + i, _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvtusepi32_epi16(lo)),
+                                                        _mm512_cvtusepi32_epi16(hi), 1));
+    }
+    tig_over_rgba64_avx2(src + i, dst + i, n - i);
+}
+
+#pragma GCC diagnostic pop
+
+#endif  // TIG_SIMD_X86
+
+// ---------------------------------------------------------------------------
+// Dispatch
+// ---------------------------------------------------------------------------
+
+// Highest level this CPU (and OS, for AVX state) supports.
+inline TigSimdLevel tig_simd_detect() {
+#ifdef TIG_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) return TIG_SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return TIG_SIMD_AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return TIG_SIMD_SSE4;
+#endif
+    return TIG_SIMD_SCALAR;
+}
+
+inline TigKernels tig_kernels_for(TigSimdLevel level) {
+    TigKernels k = {TIG_SIMD_SCALAR, tig_argb32_to_rgba_scalar, tig_absdiff_count_scalar, tig_scale_argb32_scalar,
+                    tig_diff_span_scalar, tig_over_argb32_scalar,
+                    tig_box_step_scalar, tig_over_rgba64_scalar};
+#ifdef TIG_SIMD_X86
+    switch (level) {
+        case TIG_SIMD_AVX512:
+            k = {TIG_SIMD_AVX512, tig_argb32_to_rgba_avx512, tig_absdiff_count_avx512, tig_scale_argb32_avx512,
+                 tig_diff_span_avx512, tig_over_argb32_avx512,
+                 tig_box_step_avx512, tig_over_rgba64_avx512};
+            break;
+        case TIG_SIMD_AVX2:
+            k = {TIG_SIMD_AVX2, tig_argb32_to_rgba_avx2, tig_absdiff_count_avx2, tig_scale_argb32_avx2,
+                 tig_diff_span_avx2, tig_over_argb32_avx2,
+                 tig_box_step_avx2, tig_over_rgba64_avx2};
+            break;
+        case TIG_SIMD_SSE4:
+            k = {TIG_SIMD_SSE4, tig_argb32_to_rgba_sse4, tig_absdiff_count_sse2, tig_scale_argb32_sse2,
+                 tig_diff_span_sse2, tig_over_argb32_sse2,
+                 tig_box_step_sse4, tig_over_rgba64_sse4};
+            break;
+        default:
+            break;
+    }
+#else
+    (void)level;
+#endif
+    return k;
+}
+
+inline TigKernels& tig_kernels_mut() {
+    static TigKernels kernels = tig_kernels_for(tig_simd_detect());
+    return kernels;
+}
+
+inline const TigKernels& tig_kernels() { return tig_kernels_mut(); }
+
+// Applies a --simd value. Levels the CPU lacks fall back to the best supported
+// one with a warning. Returns false for an unknown name.
+inline bool tig_simd_select(const std::string& name) {
+    TigSimdLevel want;
+    if (name == "auto") want = tig_simd_detect();
+    else if (name == "scalar") want = TIG_SIMD_SCALAR;
+    else if (name == "sse4") want = TIG_SIMD_SSE4;
+    else if (name == "avx2") want = TIG_SIMD_AVX2;
+    else if (name == "avx512") want = TIG_SIMD_AVX512;
+    else return false;
+
+    TigSimdLevel have = tig_simd_detect();
+    if (want > have) {
+        std::fprintf(stderr, "Warning: --simd=%s not supported by this CPU, using %s\n",
+                     name.c_str(), tig_simd_name(have));
+        want = have;
+    }
+    tig_kernels_mut() = tig_kernels_for(want);
+    return true;
+}
+
+#endif  // TIG_SIMD_H
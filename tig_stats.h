@@ -0,0 +1,262 @@
+/*
+ * tig_stats.h - Per-stage timing and (optional) allocation accounting for text2png
+ *
+ * Always available: wall time per render stage and peak RSS, printed by --stats,
+ * with the CPU and memory limits of the cgroup and the --jobs worker count.
+ *
+ * Instrumentation build (-DTIG_INSTRUMENT): additionally replaces the global
+ * operator new/delete to count allocations, bytes and the live-bytes high-water
+ * mark attributed to the stage that was active, and tracks cairo image surface
+ * bytes created through tig_surface_create(). The replacement operators are
+ * defined here, so include this header from exactly one translation unit.
+ */
+
+#ifndef TIG_STATS_H
+#define TIG_STATS_H
+
+#include <cairo.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sys/resource.h>
+#include <thread>
+
+#include "tig_cgroup.h"
+
+#ifdef TIG_INSTRUMENT
+#include <malloc.h>
+#endif
+
+enum TigStage {
+    TIG_STAGE_SETUP = 0,  // argument parsing, input reading, bookkeeping
+    TIG_STAGE_FONT,       // FontConfig match + FreeType face load
+    TIG_STAGE_LAYOUT,     // text measurement
+    TIG_STAGE_RASTER,     // surface creation, background, outline and fill
+    TIG_STAGE_ENCODE,     // PNG encoding (into memory)
+    TIG_STAGE_WRITE,      // output file write
+    TIG_STAGE_COUNT
+};
+
+inline const char* tig_stage_name(int stage) {
+    static const char* names[TIG_STAGE_COUNT] = {"setup", "font", "layout", "raster", "encode", "write"};
+    return names[stage];
+}
+
+struct TigStageCounters {
+    std::atomic<uint64_t> nanos{0};
+    std::atomic<uint64_t> allocs{0};
+    std::atomic<uint64_t> alloc_bytes{0};
+    std::atomic<uint64_t> peak_live{0};      // highest process live bytes seen in this stage
+    std::atomic<uint64_t> surfaces{0};
+    std::atomic<uint64_t> surface_bytes{0};
+};
+
+struct TigStats {
+    TigStageCounters stage[TIG_STAGE_COUNT];
+    std::atomic<uint64_t> live_bytes{0};
+    std::atomic<uint64_t> peak_live_bytes{0};
+    std::atomic<uint64_t> live_surface_bytes{0};
+    std::atomic<uint64_t> peak_surface_bytes{0};
+    std::atomic<uint64_t> max_line_allocs{0};
+};
+
+// Function-local statics: usable from operator new before main() runs.
+inline TigStats& tig_stats() {
+    static TigStats stats;
+    return stats;
+}
+
+inline int& tig_current_stage() {
+    static thread_local int stage = TIG_STAGE_SETUP;
+    return stage;
+}
+
+inline void tig_atomic_max(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t cur = target.load(std::memory_order_relaxed);
+    while (value > cur && !target.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+    }
+}
+
+// RAII: attributes time (and allocations) to the active stage. next() moves
+// the same scope on to the following stage; the outer stage is restored on exit.
+class TigStageScope {
+public:
+    explicit TigStageScope(TigStage stage)
+        : prev_(tig_current_stage()), stage_(stage), start_(std::chrono::steady_clock::now()) {
+        tig_current_stage() = stage;
+    }
+    ~TigStageScope() {
+        flush();
+        tig_current_stage() = prev_;
+    }
+    void next(TigStage stage) {
+        flush();
+        stage_ = stage;
+        tig_current_stage() = stage;
+    }
+    TigStageScope(const TigStageScope&) = delete;
+    TigStageScope& operator=(const TigStageScope&) = delete;
+
+private:
+    void flush() {
+        auto now = std::chrono::steady_clock::now();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_).count();
+        tig_stats().stage[stage_].nanos.fetch_add(static_cast<uint64_t>(ns), std::memory_order_relaxed);
+        start_ = now;
+    }
+
+    int prev_;
+    TigStage stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+inline uint64_t tig_total_allocs() {
+    uint64_t n = 0;
+    for (const auto& s : tig_stats().stage) n += s.allocs.load(std::memory_order_relaxed);
+    return n;
+}
+
+#ifdef TIG_INSTRUMENT
+
+inline void tig_surface_release(void* bytes) {
+    tig_stats().live_surface_bytes.fetch_sub(reinterpret_cast<uintptr_t>(bytes), std::memory_order_relaxed);
+}
+
+// cairo_image_surface_create() plus byte accounting; the user-data destroy
+// callback fires when cairo finalizes the surface.
+inline cairo_surface_t* tig_surface_create(cairo_format_t format, int width, int height) {
+    static cairo_user_data_key_t key;
+    cairo_surface_t* surface = cairo_image_surface_create(format, width, height);
+    uint64_t bytes = static_cast<uint64_t>(cairo_format_stride_for_width(format, width)) * static_cast<uint64_t>(height);
+    TigStats& st = tig_stats();
+    TigStageCounters& s = st.stage[tig_current_stage()];
+    s.surfaces.fetch_add(1, std::memory_order_relaxed);
+    s.surface_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    tig_atomic_max(st.peak_surface_bytes, st.live_surface_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+    cairo_surface_set_user_data(surface, &key, reinterpret_cast<void*>(static_cast<uintptr_t>(bytes)), tig_surface_release);
+    return surface;
+}
+
+inline void tig_note_alloc(void* p) {
+    if (!p) return;
+    uint64_t size = malloc_usable_size(p);
+    TigStats& st = tig_stats();
+    TigStageCounters& s = st.stage[tig_current_stage()];
+    s.allocs.fetch_add(1, std::memory_order_relaxed);
+    s.alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    uint64_t live = st.live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    tig_atomic_max(st.peak_live_bytes, live);
+    tig_atomic_max(s.peak_live, live);
+}
+
+inline void tig_note_free(void* p) {
+    if (p) tig_stats().live_bytes.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t size) {
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    tig_note_alloc(p);
+    return p;
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    void* p = std::malloc(size ? size : 1);
+    tig_note_alloc(p);
+    return p;
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* p) noexcept { tig_note_free(p); std::free(p); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { operator delete(p); }
+
+#else
+
+inline cairo_surface_t* tig_surface_create(cairo_format_t format, int width, int height) {
+    return cairo_image_surface_create(format, width, height);
+}
+
+#endif  // TIG_INSTRUMENT
+
+// Line workers of a --jobs run; workers = 0 when lines ran one at a time.
+struct TigWorkerReport {
+    unsigned workers = 0;  // fixed count, or the count at the end with --jobs auto
+    bool adaptive = false;
+    unsigned start = 0, lowest = 0, highest = 0, changes = 0;
+};
+
+inline TigWorkerReport& tig_worker_report() {
+    static TigWorkerReport report;
+    return report;
+}
+
+// Call after each rendered line with the allocation count sampled before it.
+inline void tig_note_line_allocs(uint64_t allocs_before) {
+    tig_atomic_max(tig_stats().max_line_allocs, tig_total_allocs() - allocs_before);
+}
+
+inline void tig_print_stats(FILE* out, uint64_t lines, uint64_t images, uint64_t bytes_written, double wall_s) {
+    struct rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    const TigStats& st = tig_stats();
+
+    std::fprintf(out, "\n=== Stats ===\n");
+    std::fprintf(out, "Lines rendered: %llu\n", static_cast<unsigned long long>(lines));
+    std::fprintf(out, "Wall time:      %.3f s (%.1f lines/s)\n", wall_s, wall_s > 0 ? lines / wall_s : 0.0);
+    std::fprintf(out, "Images written: %llu\n", static_cast<unsigned long long>(images));
+    std::fprintf(out, "Bytes written:  %llu (%.1f per image)\n", static_cast<unsigned long long>(bytes_written),
+                 images ? static_cast<double>(bytes_written) / images : 0.0);
+    std::fprintf(out, "Peak RSS:       %ld KiB\n", ru.ru_maxrss);
+    const TigCgroup& cg = tig_cgroup();
+    std::fprintf(out, "CPU budget:     %u (%u hardware threads", tig_cpu_budget(),
+                 std::max(1u, std::thread::hardware_concurrency()));
+    if (cg.cpus > 0) std::fprintf(out, ", cgroup cpu.max %.2f CPUs", cg.cpus);
+    std::fprintf(out, ")\n");
+    if (cg.memory_max) {
+        std::fprintf(out, "Memory limit:   %llu MiB (cgroup memory.max)\n",
+                     static_cast<unsigned long long>(cg.memory_max >> 20));
+    }
+    const TigWorkerReport& w = tig_worker_report();
+    if (w.adaptive) {
+        std::fprintf(out, "Workers:        %u at end (auto: started at %u, range %u-%u, %u changes)\n", w.workers,
+                     w.start, w.lowest, w.highest, w.changes);
+    } else if (w.workers) {
+        std::fprintf(out, "Workers:        %u\n", w.workers);
+    }
+#ifdef TIG_INSTRUMENT
+    std::fprintf(out, "\n%-8s %10s %12s %14s %14s %9s %14s\n",
+                 "stage", "time(s)", "allocs", "alloc bytes", "peak live", "surfaces", "surface bytes");
+    for (int i = 0; i < TIG_STAGE_COUNT; ++i) {
+        const TigStageCounters& s = st.stage[i];
+        std::fprintf(out, "%-8s %10.3f %12llu %14llu %14llu %9llu %14llu\n", tig_stage_name(i),
+                     s.nanos.load() / 1e9,
+                     static_cast<unsigned long long>(s.allocs.load()),
+                     static_cast<unsigned long long>(s.alloc_bytes.load()),
+                     static_cast<unsigned long long>(s.peak_live.load()),
+                     static_cast<unsigned long long>(s.surfaces.load()),
+                     static_cast<unsigned long long>(s.surface_bytes.load()));
+    }
+    uint64_t total = tig_total_allocs();
+    std::fprintf(out, "\nHeap high-water (operator new): %llu bytes\n",
+                 static_cast<unsigned long long>(st.peak_live_bytes.load()));
+    std::fprintf(out, "Surface high-water:             %llu bytes\n",
+                 static_cast<unsigned long long>(st.peak_surface_bytes.load()));
+    std::fprintf(out, "Allocations per line:           %.1f avg, %llu max\n",
+                 lines ? static_cast<double>(total) / lines : 0.0,
+                 static_cast<unsigned long long>(st.max_line_allocs.load()));
+#else
+    std::fprintf(out, "\n%-8s %10s\n", "stage", "time(s)");
+    for (int i = 0; i < TIG_STAGE_COUNT; ++i) {
+        std::fprintf(out, "%-8s %10.3f\n", tig_stage_name(i), st.stage[i].nanos.load() / 1e9);
+    }
+    std::fprintf(out, "(build with -DTIG_INSTRUMENT for allocation counts)\n");
+#endif
+    std::fprintf(out, "=============\n");
+}
+
+#endif  // TIG_STATS_H
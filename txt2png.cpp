@@ -8,6 +8,9 @@
 //  - Point size control
 //  - Output file pattern: "<prefix><line_no>.png" (1-based), e.g., lyrics-12.png
 //  - Uses ImageMagick "label:" rendering so the canvas auto-sizes to fit the text.
+//  - --shard I/N renders one node's share of the lines and writes a partial
+//    manifest; --merge-manifests combines them.
+//  - --checkpoint journals finished lines; --resume skips those with intact outputs.
 //
 // Note on outline: We use ImageMagick's native stroke for quality & speed.
 // If you *really* want the "offset halo" method, see --outline-method=offset (experimental).
@@ -28,6 +31,15 @@
 #include <iterator>
 #include <regex>
 #include <cmath>
+#include <memory>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "tig_checkpoint.h"
+#include "tig_manifest.h"
+#include "tig_progress.h"
+#include "tig_shard.h"
 
 #if defined(_WIN32)
 #error "This tool targets Linux/Unix environments."
@@ -146,12 +158,19 @@ struct Options {
     bool use_offset_outline = false;
     int offset_directions = 36; // for experimental offset method
     bool dry_run = false;
+    bool progress = false;
+    std::string manifest = ""; // JSON Lines record of written files; empty = none
+    TigShard shard;            // --shard I/N
+    bool checkpoint = false;   // journal finished lines to '<prefix>checkpoint.jsonl'
+    bool resume = false;       // skip the lines the journal lists with intact outputs
+    std::vector<std::string> merge_parts; // --merge-manifests OUT PART...: [0] is OUT
     std::string im_exe = ""; // detected at runtime
 };
 
 void print_help(const char* argv0) {
     std::cout << "Usage:\n"
-              << "  " << argv0 << " --input FILE [options]\n\n"
+              << "  " << argv0 << " --input FILE [options]\n"
+              << "  " << argv0 << " --merge-manifests OUT PART...\n\n"
               << "Options:\n"
               << "  --input FILE            Input text file (one image per non-empty line)\n"
               << "  --prefix STR            Output prefix. Files are '<prefix><N>.png' (default: none)\n"
@@ -166,6 +185,16 @@ void print_help(const char* argv0) {
               << "  --outline-method METHOD Outline method: 'stroke' (default) or 'offset'\n"
               << "  --offset-directions N   Directions for 'offset' halo (default: 36)\n"
               << "  --dry-run               Show commands but do not execute\n"
+              << "  --progress              Show progress (lines/s, ETA, bytes) on stderr\n"
+              << "  --manifest FILE         Record written files as JSON Lines\n"
+              << "  --shard I/N             Render only shard I of N of the lines, keeping global numbering;\n"
+              << "                          writes '<prefix>manifest-shard-IofN.jsonl' unless --manifest is given\n"
+              << "  --shard-mode MODE       round-robin (default) or contiguous blocks\n"
+              << "  --merge-manifests OUT PART...  Combine partial manifests into OUT and exit\n"
+              << "  --checkpoint            Journal finished lines to '<prefix>checkpoint.jsonl'; SIGINT/SIGTERM\n"
+              << "                          stop after the current line\n"
+              << "  --resume                Continue a checkpointed run: skip lines whose outputs are intact\n"
+              << "                          (refused if the render options changed)\n"
               << "  --help                  Show this help\n\n"
               << "Notes:\n"
               << "  * Requires ImageMagick CLI ('magick' or 'convert') in PATH.\n"
@@ -204,11 +233,31 @@ bool parse_args(int argc, char** argv, Options& opt) {
         }
         else if (a == "--offset-directions") { if (!need_val("--offset-directions")) return false; opt.offset_directions = std::stoi(argv[++i]); }
         else if (a == "--dry-run") { opt.dry_run = true; }
+        else if (a == "--progress") { opt.progress = true; }
+        else if (a == "--manifest") { if (!need_val("--manifest")) return false; opt.manifest = argv[++i]; }
+        else if (a == "--shard") {
+            if (!need_val("--shard")) return false;
+            std::string spec = argv[++i];
+            if (!tig_shard_parse(spec, opt.shard)) { std::cerr << "Invalid --shard: " << spec << " (expected I/N with 1 <= I <= N)\n"; return false; }
+        }
+        else if (a == "--shard-mode") {
+            if (!need_val("--shard-mode")) return false;
+            std::string m = argv[++i];
+            if (!tig_shard_set_mode(m, opt.shard)) { std::cerr << "Unknown shard mode: " << m << "\n"; return false; }
+        }
+        else if (a == "--checkpoint") { opt.checkpoint = true; }
+        else if (a == "--resume") { opt.checkpoint = opt.resume = true; }
+        else if (a == "--merge-manifests") {
+            if (i + 2 >= argc) { std::cerr << "--merge-manifests needs OUT and at least one PART\n"; return false; }
+            opt.merge_parts.assign(argv + i + 1, argv + argc);
+            return true;
+        }
         else {
             std::cerr << "Unknown option: " << a << "\n";
             return false;
         }
     }
+    if (opt.shard.count > 1 && opt.manifest.empty()) opt.manifest = tig_shard_manifest_name(opt.prefix, opt.shard);
     if (opt.input_path.empty() && !opt.list_fonts) {
         std::cerr << "Error: --input FILE required (unless using --list-fonts)\n";
         return false;
@@ -216,6 +265,16 @@ bool parse_args(int argc, char** argv, Options& opt) {
     return true;
 }
 
+// Width and height from a PNG's IHDR; false if the file is not a PNG.
+bool png_size(const std::string& path, int& width, int& height) {
+    unsigned char head[24];
+    std::ifstream in(path, std::ios::binary);
+    if (!in.read(reinterpret_cast<char*>(head), sizeof(head)) || std::memcmp(head + 12, "IHDR", 4) != 0) return false;
+    width = (head[16] << 24) | (head[17] << 16) | (head[18] << 8) | head[19];
+    height = (head[20] << 24) | (head[21] << 16) | (head[22] << 8) | head[23];
+    return true;
+}
+
 // Build IM command using "stroke" method.
 std::string build_cmd_stroke(const std::string& im_exe,
                              const std::string& text,
@@ -289,6 +348,16 @@ int main(int argc, char** argv) {
         return 2;
     }
 
+    if (!opt.merge_parts.empty()) {
+        std::string error;
+        if (!tig_manifest_merge(std::vector<std::string>(opt.merge_parts.begin() + 1, opt.merge_parts.end()),
+                                opt.merge_parts[0], error)) {
+            std::cerr << error << "\n";
+            return 8;
+        }
+        return 0;
+    }
+
     opt.im_exe = detect_imagemagick();
     if (opt.im_exe.empty()) {
         std::cerr << "Error: Could not find ImageMagick CLI ('magick' or 'convert') in PATH.\n";
@@ -326,12 +395,55 @@ int main(int argc, char** argv) {
         return 6;
     }
 
+    // Contiguous shards need the line count up front; so does --progress
+    uint64_t total = 0;
+    if (opt.shard.contiguous || (opt.progress && !opt.dry_run)) {
+        total = TigProgress::count_lines(opt.input_path, true);
+        tig_shard_plan(opt.shard, total);
+    }
+
+    std::unique_ptr<TigProgress> progress;
+    if (opt.progress && !opt.dry_run) {
+        progress.reset(new TigProgress(tig_shard_share(opt.shard, total)));
+        progress->start();
+    }
+
+    std::unique_ptr<TigCheckpoint> journal;
+    if (opt.checkpoint && !opt.dry_run) {
+        const std::string path = tig_checkpoint_name(opt.prefix, opt.shard);
+        // Everything that shapes the images; outputs of other settings are not reused
+        const std::string settings = opt.im_exe + ";" + font + ";" + std::to_string(opt.point_size) + ";" +
+                                     opt.fill_color + ";" + opt.outline_color + ";" +
+                                     std::to_string(opt.outline_thickness) + ";" +
+                                     (opt.use_offset_outline ? "offset " + std::to_string(opt.offset_directions)
+                                                             : std::string("stroke"));
+        journal.reset(new TigCheckpoint());
+        std::string error;
+        if (!journal->open(path, opt.resume, tig_text_hash(settings), error)) {
+            std::cerr << "Error: " << error << "\n";
+            return 8;
+        }
+        tig_install_stop_handlers();
+    }
+
     std::string line;
     int lineno = opt.start_index;
-    int made = 0;
+    int made = 0, resumed = 0;
+    uint64_t ordinal = 0;
+    std::vector<TigManifestEntry> records;
     while (std::getline(in, line)) {
         std::string t = trim(line);
         if (t.empty()) { ++lineno; continue; }
+        if (!tig_shard_owns(opt.shard, ++ordinal)) { ++lineno; continue; }
+
+        const std::vector<TigManifestEntry>* done = journal ? journal->done(lineno, tig_text_hash(line)) : nullptr;
+        if (done) {
+            records.insert(records.end(), done->begin(), done->end());
+            ++resumed;
+            if (progress) progress->add(1, 0);
+            ++lineno;
+            continue;
+        }
 
         std::ostringstream outname;
         outname << opt.prefix << lineno << ".png";
@@ -348,18 +460,55 @@ int main(int argc, char** argv) {
             std::cout << cmd << "\n";
         } else {
             int rc = std::system(cmd.c_str());
+            // system() ignores SIGINT while ImageMagick runs; Ctrl-C ends the child instead
+            const bool interrupted = (WIFSIGNALED(rc) && WTERMSIG(rc) == SIGINT) ||
+                                     (WIFEXITED(rc) && WEXITSTATUS(rc) == 128 + SIGINT);
+            if (journal && interrupted) {
+                tig_stop_signal() = SIGINT;
+                break;
+            }
             if (rc != 0) {
                 std::cerr << "Command failed (rc=" << rc << "): " << cmd << "\n";
                 return 7;
             }
             ++made;
+            struct stat st{};
+            const uint64_t bytes = stat(out_path.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+            if (progress) progress->add(1, bytes);
+            if (!opt.manifest.empty() || journal) {
+                TigManifestEntry e;
+                e.line = lineno;
+                e.file = out_path;
+                e.text_hash = tig_text_hash(line);
+                png_size(out_path, e.width, e.height);
+                e.bytes = bytes;
+                records.push_back(e);
+                if (journal && !journal->record({e})) {
+                    std::cerr << "Error writing checkpoint\n";
+                    return 8;
+                }
+            }
         }
 
         ++lineno;
+        if (tig_stop_signal()) break;
     }
 
+    if (progress) progress->stop();
+    if (journal) {
+        if (!journal->close()) {
+            std::cerr << "Error writing checkpoint\n";
+            return 8;
+        }
+        if (opt.resume) std::cerr << "Resumed: " << resumed << " lines were already done.\n";
+        if (tig_stop_signal()) std::cerr << "Interrupted; run again with --resume to continue.\n";
+    }
     if (!opt.dry_run) {
         std::cerr << "Wrote " << made << " PNG files.\n";
+        if (!opt.manifest.empty() && !tig_manifest_save(opt.manifest, records)) {
+            std::cerr << "Error writing manifest: " << opt.manifest << "\n";
+            return 8;
+        }
     }
-    return 0;
+    return tig_stop_signal() ? 128 + tig_stop_signal() : 0;
 }